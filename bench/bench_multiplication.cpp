@@ -0,0 +1,206 @@
+#include "batched.h"
+#include "kernels.h"
+#include "matrix_multiplication.h"
+#include "strassen.h"
+#include "thread_pool.h"
+#include "tiling.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#ifndef MATMUL_BUILD_TYPE
+#define MATMUL_BUILD_TYPE "unknown"
+#endif
+
+namespace {
+
+// Same matrices on every run, so that reports of two releases compare the same work
+constexpr unsigned BENCH_SEED = 42;
+
+template <typename T>
+Matrix<T> randomMatrix(int rows, int cols, std::mt19937& gen) {
+    std::uniform_int_distribution<> dis(-8, 8);
+    Matrix<T> m(rows, cols);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            m(i, j) = static_cast<T>(dis(gen));
+        }
+    }
+    return m;
+}
+
+/*
+ * Nominal peak of the host in operations per second for Acc on an instruction set: two
+ * FMA pipes of full vectors (one lane without SIMD) per core and per cycle, times the pool
+ * threads. $MATMUL_PEAK_GOPS replaces it with a measured or datasheet figure.
+ */
+double peakOps(Isa isa, std::size_t accBytes) {
+    if (const char* env = std::getenv("MATMUL_PEAK_GOPS")) {
+        return std::atof(env) * 1e9;
+    }
+    const std::size_t vectorBytes = isa == Isa::Avx512 ? 64 : isa == Isa::Avx2 ? 32 : accBytes;
+    const double lanes = static_cast<double>(std::max<std::size_t>(1, vectorBytes / accBytes));
+    return benchmark::CPUInfo::Get().cycles_per_second * lanes * 2 * 2 * ThreadPool::global().size();
+}
+
+/*
+ * Counters of a product of M x K by K x N: GOP per second (2 MNK operations per product),
+ * the compulsory traffic of reading A and B and writing C once, in bytes per iteration and
+ * as GB per second, and the percentage of the nominal peak reached
+ */
+template <typename T, typename Acc>
+void report(benchmark::State& state, double products, long long M, long long K, long long N, Isa isa) {
+    const double ops = 2.0 * M * N * K * products;
+    const double bytes = ((M * K + K * N) * sizeof(T) + M * N * sizeof(Acc)) * products;
+    state.counters["GOP"] = benchmark::Counter(ops * 1e-9, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["bytes"] = bytes;
+    state.counters["GB"] = benchmark::Counter(bytes * 1e-9, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["peak%"] = benchmark::Counter(100.0 * ops / peakOps(isa, sizeof(Acc)),
+                                                 benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// Runs the benchmark body with the given instruction set, then restores the detected one
+template <typename Body>
+void withIsa(Isa isa, Body body) {
+    const Isa previous = activeIsa();
+    setIsa(isa);
+    body();
+    setIsa(previous);
+}
+
+// C = A * B through multiplyMatrices, which also dispatches the vector shapes
+template <typename T, typename Acc>
+void benchMultiply(benchmark::State& state, Isa isa, int M, int K, int N) {
+    std::mt19937 gen(BENCH_SEED);
+    const Matrix<T> A = randomMatrix<T>(M, K, gen);
+    const Matrix<T> B = randomMatrix<T>(K, N, gen);
+    Matrix<Acc> C(M, N);
+    withIsa(isa, [&] {
+        for (auto _ : state) {
+            multiplyMatrices<T, Acc>(A, B, C);
+            benchmark::DoNotOptimize(C.data());
+            benchmark::ClobberMemory();
+        }
+    });
+    report<T, Acc>(state, 1, M, K, N, isa);
+}
+
+void benchStrassen(benchmark::State& state, int n) {
+    std::mt19937 gen(BENCH_SEED);
+    const Matrix<int> A = randomMatrix<int>(n, n, gen);
+    const Matrix<int> B = randomMatrix<int>(n, n, gen);
+    Matrix<int> C(n, n);
+    for (auto _ : state) {
+        multiplyStrassen(A, B, C, strassenCutoff());
+        benchmark::DoNotOptimize(C.data());
+        benchmark::ClobberMemory();
+    }
+    report<int, int>(state, 1, n, n, n, activeIsa());
+}
+
+template <typename T, typename Acc>
+void benchBatched(benchmark::State& state, int count, int n) {
+    std::mt19937 gen(BENCH_SEED);
+    const Matrix<T> A = randomMatrix<T>(count * n, n, gen);
+    const Matrix<T> B = randomMatrix<T>(count * n, n, gen);
+    Matrix<Acc> C(count * n, n);
+    for (auto _ : state) {
+        multiplyBatched<T, Acc>(StridedBatch<const T>(A.data(), count, n, n),
+                                StridedBatch<const T>(B.data(), count, n, n), StridedBatch<Acc>(C.data(), count, n, n));
+        benchmark::DoNotOptimize(C.data());
+        benchmark::ClobberMemory();
+    }
+    report<T, Acc>(state, count, n, n, n, activeIsa());
+}
+
+std::string shapeName(int M, int K, int N) {
+    return std::to_string(M) + "x" + std::to_string(K) + "x" + std::to_string(N);
+}
+
+template <typename T, typename Acc>
+void registerMultiply(const std::string& group, const std::string& type, Isa isa, int M, int K, int N) {
+    const std::string name = group + "/" + type + "/" + isaName(isa) + "/" + shapeName(M, K, N);
+    benchmark::RegisterBenchmark(name.c_str(), benchMultiply<T, Acc>, isa, M, K, N)->Unit(benchmark::kMillisecond);
+}
+
+/*
+ * The sweep: square int32 sizes on every supported instruction set, every (element,
+ * accumulator) pair at one size, the skinny and vector shapes, Strassen-Winograd and
+ * batches of small products
+ */
+void registerBenchmarks() {
+    const Isa best = activeIsa();
+    for (Isa isa : {Isa::Scalar, Isa::Avx2, Isa::Avx512}) {
+        if (!isaSupported(isa)) {
+            continue;
+        }
+        for (int n : {64, 128, 256, 512, 1024}) {
+            registerMultiply<std::int32_t, std::int32_t>("square", "int32", isa, n, n, n);
+        }
+    }
+
+    using std::int8_t, std::int16_t, std::int32_t, std::int64_t;
+    const int n = 512;
+    registerMultiply<int8_t, int32_t>("types", "int8-int32", best, n, n, n);
+    registerMultiply<int8_t, int64_t>("types", "int8-int64", best, n, n, n);
+    registerMultiply<int16_t, int32_t>("types", "int16-int32", best, n, n, n);
+    registerMultiply<int16_t, int64_t>("types", "int16-int64", best, n, n, n);
+    registerMultiply<int32_t, int32_t>("types", "int32-int32", best, n, n, n);
+    registerMultiply<int32_t, int64_t>("types", "int32-int64", best, n, n, n);
+    registerMultiply<int64_t, int64_t>("types", "int64-int64", best, n, n, n);
+    registerMultiply<float, float>("types", "float32-float32", best, n, n, n);
+    registerMultiply<float, double>("types", "float32-float64", best, n, n, n);
+    registerMultiply<double, double>("types", "float64-float64", best, n, n, n);
+
+    // M x K x N: tall-skinny, short-wide, long inner dimension, GEMV, GEVM and outer product
+    const int shapes[][3] = {{16384, 64, 64}, {64, 64, 16384}, {64, 16384, 64},
+                             {4096, 4096, 1},  {1, 4096, 4096}, {2048, 1, 2048}};
+    for (const auto& shape : shapes) {
+        registerMultiply<int32_t, int32_t>("shape", "int32", best, shape[0], shape[1], shape[2]);
+        registerMultiply<float, float>("shape", "float32", best, shape[0], shape[1], shape[2]);
+    }
+
+    for (int size : {512, 1024}) {
+        const std::string name = "strassen/int32/" + std::string(isaName(best)) + "/" + shapeName(size, size, size);
+        benchmark::RegisterBenchmark(name.c_str(), benchStrassen, size)->Unit(benchmark::kMillisecond);
+    }
+
+    for (int size : {4, 8, 16, 32, 64}) {
+        const int count = 4096;
+        const std::string suffix = std::string(isaName(best)) + "/" + std::to_string(count) + "x" +
+                                   shapeName(size, size, size);
+        benchmark::RegisterBenchmark(("batched/int32/" + suffix).c_str(), benchBatched<int32_t, int32_t>, count,
+                                     size)->Unit(benchmark::kMicrosecond);
+        benchmark::RegisterBenchmark(("batched/float32/" + suffix).c_str(), benchBatched<float, float>, count,
+                                     size)->Unit(benchmark::kMicrosecond);
+    }
+}
+
+} // namespace
+
+// GEMM performance report: pass --benchmark_format=json (or --benchmark_out=FILE) for a
+// JSON report, and --benchmark_filter=REGEX to run part of the sweep
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    const TileSizes tiles = tileSizes();
+    benchmark::AddCustomContext("matmul_build_type", MATMUL_BUILD_TYPE);
+    benchmark::AddCustomContext("matmul_isa", isaName(activeIsa()));
+    benchmark::AddCustomContext("matmul_threads", std::to_string(ThreadPool::global().size()));
+    benchmark::AddCustomContext("matmul_tiles", "mc=" + std::to_string(tiles.mc) + " kc=" + std::to_string(tiles.kc) +
+                                                    " nc=" + std::to_string(tiles.nc));
+    benchmark::AddCustomContext("matmul_strassen_cutoff", std::to_string(strassenCutoff()));
+    benchmark::AddCustomContext("matmul_peak_gops_float32",
+                                std::to_string(peakOps(activeIsa(), sizeof(float)) * 1e-9));
+
+    registerBenchmarks();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,105 @@
+#ifndef BATCHED_H
+#define BATCHED_H
+
+#include "distribution.h"
+#include "matrix.h"
+#include "matrix_multiplication.h"
+#include <cstddef>
+#include <type_traits>
+
+/*
+ * A batch of `count` equally sized row-major matrices in one buffer: matrix b starts at
+ * data + b * batchStride and its rows are `stride` elements apart. A packed batch has
+ * stride == cols and batchStride == rows * cols, which is also a (count * rows) x cols
+ * Matrix with the batch stacked row-wise.
+ */
+template <typename T>
+class StridedBatch {
+public:
+    StridedBatch() = default;
+
+    StridedBatch(T* data, int count, int rows, int cols, std::ptrdiff_t stride, std::ptrdiff_t batchStride)
+        : data_(data), count_(count), rows_(rows), cols_(cols), stride_(stride), batchStride_(batchStride) {}
+
+    StridedBatch(T* data, int count, int rows, int cols)
+        : StridedBatch(data, count, rows, cols, cols, static_cast<std::ptrdiff_t>(rows) * cols) {}
+
+    // Allows StridedBatch<int> -> StridedBatch<const int>
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    StridedBatch(const StridedBatch<U>& other)
+        : data_(other.data()), count_(other.count()), rows_(other.rows()), cols_(other.cols()),
+          stride_(other.stride()), batchStride_(other.batchStride()) {}
+
+    T* data() const { return data_; }
+    int count() const { return count_; }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    std::ptrdiff_t stride() const { return stride_; }
+    std::ptrdiff_t batchStride() const { return batchStride_; }
+
+    MatrixView<T> operator[](int b) const { return MatrixView<T>(data_ + b * batchStride_, rows_, cols_, stride_); }
+
+private:
+    T* data_ = nullptr;
+    int count_ = 0;
+    int rows_ = 0;
+    int cols_ = 0;
+    std::ptrdiff_t stride_ = 0;
+    std::ptrdiff_t batchStride_ = 0;
+};
+
+/*
+ * Computes C[b] = A[b] * B[b] for every matrix of the batch, with A[b] (m x k), B[b] (k x n)
+ * and C[b] (m x n). Meant for many small products: there is no tiling or per-call setup,
+ * products whose m, k and n are each 4, 8 or 16 run a kernel unrolled for that shape, other
+ * sizes (32 and up included, where it is faster) call the block kernel directly, and the
+ * batch is shared out among the pool threads.
+ */
+template <typename T, typename Acc = AccumulatorOf<T>>
+void multiplyBatched(StridedBatch<const T> A, StridedBatch<const T> B, StridedBatch<Acc> C);
+
+// Pointer-array form: A[b], B[b] and C[b] point to packed row-major matrices anywhere in memory
+template <typename T, typename Acc = AccumulatorOf<T>>
+void multiplyBatched(const T* const* A, const T* const* B, Acc* const* C, int count, int m, int k, int n);
+
+inline void multiplyBatched(StridedBatch<const int> A, StridedBatch<const int> B, StridedBatch<int> C) {
+    multiplyBatched<int, int>(A, B, C);
+}
+
+/*
+ * Distributed batch: A (count * m x k), B (count * k x n) and C (count * m x n) hold packed
+ * batches stacked row-wise on root. Every rank receives a balanced share of the matrices
+ * (as whole row blocks, with scatterRows), multiplies them with multiplyBatched, and the
+ * products are gathered back into C on root.
+ */
+template <typename T, typename Acc = AccumulatorOf<T>>
+void multiplyBatchedAll(const Matrix<T>& A, const Matrix<T>& B, Matrix<Acc>& C, int count, int m, int k, int n,
+                        int root, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    const RowPartition matrices = RowPartition::balanced(count, size);
+    auto rowsOf = [&](int rowsPerMatrix) {
+        RowPartition rows = matrices;
+        for (int r = 0; r < size; ++r) {
+            rows.counts[r] *= rowsPerMatrix;
+            rows.offsets[r] *= rowsPerMatrix;
+        }
+        return rows;
+    };
+    const RowPartition rowsA = rowsOf(m);
+    const RowPartition rowsB = rowsOf(k);
+    const RowPartition rowsC = rowsOf(m);
+
+    const Matrix<T> localA = scatterRows(A, k, rowsA, root, comm);
+    const Matrix<T> localB = scatterRows(B, n, rowsB, root, comm);
+    Matrix<Acc> localC(rowsC.counts[rank], n);
+    const int local = matrices.counts[rank];
+    multiplyBatched<T, Acc>(StridedBatch<const T>(localA.data(), local, m, k),
+                            StridedBatch<const T>(localB.data(), local, k, n),
+                            StridedBatch<Acc>(localC.data(), local, m, n));
+    gatherRows(localC, C, rowsC, root, comm);
+}
+
+#endif // BATCHED_H
@@ -0,0 +1,89 @@
+#ifndef CHAIN_H
+#define CHAIN_H
+
+#include "distribution.h"
+#include "matrix.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+ * Multiplication order of a chain A0 * A1 * ... * An-1, where Ai is dims[i] x dims[i + 1].
+ * The classic O(n^3) dynamic programme picks the parenthesization with the fewest
+ * multiply-adds: for a chain ending in a vector, for instance, it multiplies from the right
+ * so that every product is a matrix-vector one.
+ */
+class ChainPlan {
+public:
+    explicit ChainPlan(std::vector<int> dims);
+
+    int factors() const { return static_cast<int>(dims_.size()) - 1; }
+    const std::vector<int>& dims() const { return dims_; }
+
+    // The product of factors i..j is (Ai .. As) * (As+1 .. Aj) with s = split(i, j)
+    int split(int i, int j) const { return split_[static_cast<std::size_t>(i) * factors() + j]; }
+
+    // Multiply-adds of the planned order, and of the plain left-to-right order
+    long long cost() const { return cost_; }
+    long long leftToRightCost() const;
+
+    // The planned order written out, such as "(A0 (A1 A2))"
+    std::string toString() const;
+
+private:
+    std::string toString(int i, int j) const;
+
+    std::vector<int> dims_;
+    std::vector<int> split_;
+    long long cost_ = 0;
+};
+
+/*
+ * Buffers for the intermediate products of a chain. A released buffer is handed out again
+ * for any later product that fits in it, so evaluating a chain allocates only a few
+ * buffers, and none at all when the same pool is reused for a chain of the same shape.
+ */
+template <typename T>
+class MatrixPool {
+public:
+    // Contiguous (rows x cols) view over the smallest free buffer that is large enough
+    MatrixView<T> acquire(int rows, int cols);
+    // Gives back the buffer of a view returned by acquire
+    void release(const T* data);
+
+    // Number of buffers allocated so far
+    std::size_t buffers() const { return buffers_.size(); }
+
+private:
+    struct Buffer {
+        Matrix<T> storage;
+        bool used = false;
+    };
+
+    std::vector<Buffer> buffers_;
+};
+
+/*
+ * Computes C = factors[0] * factors[1] * ... in the order of the plan (which must match the
+ * factor shapes), with multiplyMatrices for every product and the intermediate results
+ * taken from the pool. Built for the types that accumulate in themselves (int32, int64,
+ * float and double), so that intermediate products can be multiplied again.
+ */
+template <typename T>
+void multiplyChain(const std::vector<ConstMatrixView<T>>& factors, const ChainPlan& plan, MatrixView<T> C,
+                   MatrixPool<T>& pool);
+
+template <typename T>
+Matrix<T> multiplyChain(const std::vector<ConstMatrixView<T>>& factors);
+
+/*
+ * Distributed chain in one job: `factors` are significant on root only, the plan is known
+ * on every rank. Every partial product is held as balanced row blocks, like C in the row
+ * block scheme: a factor on the left of a product is scattered, one on the right is
+ * broadcast, and a partial product on the right is first assembled on every rank with
+ * MPI_Allgatherv. Returns the rows of the result in RowPartition::balanced(dims[0], ranks).
+ */
+template <typename T>
+Matrix<T> multiplyChainAll(const std::vector<Matrix<T>>& factors, const ChainPlan& plan, int root, MPI_Comm comm);
+
+#endif // CHAIN_H
@@ -0,0 +1,286 @@
+#ifndef DISTRIBUTION_H
+#define DISTRIBUTION_H
+
+#include "matrix.h"
+#include "mpi_types.h"
+#include "profile.h"
+#include "sparse.h"
+#include <mpi.h>
+#include <cstddef>
+#include <vector>
+
+/*
+ * Split of the rows of a matrix into one contiguous block per rank.
+ * Rank r owns rows [offsets[r], offsets[r] + counts[r]).
+ */
+struct RowPartition {
+    std::vector<int> counts;
+    std::vector<int> offsets;
+
+    // Every rank gets rows / ranks rows and the first rows % ranks ranks one more
+    static RowPartition balanced(int rows, int ranks) {
+        RowPartition p;
+        p.counts.resize(ranks);
+        p.offsets.resize(ranks);
+        int offset = 0;
+        for (int r = 0; r < ranks; ++r) {
+            p.counts[r] = rows / ranks + (r < rows % ranks ? 1 : 0);
+            p.offsets[r] = offset;
+            offset += p.counts[r];
+        }
+        return p;
+    }
+};
+
+// Split of the nonzeros of a CSR matrix (given by its row pointers) that follows the split
+// of its rows: block r holds the nonzeros of the rows of `rows` block r
+RowPartition nonzeroPartition(const std::vector<int>& rowPtr, const RowPartition& rows);
+
+// Subarray datatype selecting, inside the row-major (rows x cols) matrix, the rows of
+// `partition` block `rank`; `element` itself for an empty block, which must not be freed
+MPI_Datatype rowBlockType(int rows, int cols, const RowPartition& partition, int rank, MPI_Datatype element);
+
+// Datatype of one matrix row, so counts and displacements are expressed in rows
+template <typename T>
+class RowType {
+public:
+    explicit RowType(int cols) {
+        MPI_Type_contiguous(cols, mpiType<T>(), &type_);
+        MPI_Type_commit(&type_);
+    }
+    ~RowType() { MPI_Type_free(&type_); }
+    RowType(const RowType&) = delete;
+    RowType& operator=(const RowType&) = delete;
+
+    operator MPI_Datatype() const { return type_; }
+
+private:
+    MPI_Datatype type_;
+};
+
+// Datatype of a (rows x cols) block inside a matrix whose rows are `stride` elements apart,
+// such as a column panel; one element of it is the whole block
+template <typename T>
+class BlockType {
+public:
+    BlockType(int rows, int cols, std::ptrdiff_t stride) {
+        MPI_Type_vector(rows, cols, static_cast<int>(stride), mpiType<T>(), &type_);
+        MPI_Type_commit(&type_);
+    }
+    ~BlockType() { MPI_Type_free(&type_); }
+    BlockType(const BlockType&) = delete;
+    BlockType& operator=(const BlockType&) = delete;
+
+    operator MPI_Datatype() const { return type_; }
+
+private:
+    MPI_Datatype type_;
+};
+
+// Sends row block r of `full` (significant on root only) to rank r; returns the local block
+template <typename T>
+Matrix<T> scatterRows(const Matrix<T>& full, int cols, const RowPartition& partition, int root, MPI_Comm comm) {
+    PROFILE_SCOPE(Region::Scatter);
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    Matrix<T> local(partition.counts[rank], cols);
+    RowType<T> row(cols);
+    MPI_Scatterv(full.data(), partition.counts.data(), partition.offsets.data(), row, local.data(),
+                 local.rows(), row, root, comm);
+    return local;
+}
+
+// Collects the row blocks of every rank into `full` on root (which must already be sized)
+template <typename T>
+void gatherRows(const Matrix<T>& local, Matrix<T>& full, const RowPartition& partition, int root, MPI_Comm comm) {
+    PROFILE_SCOPE(Region::Gather);
+    RowType<T> row(local.cols());
+    MPI_Gatherv(local.data(), local.rows(), row, full.data(), partition.counts.data(), partition.offsets.data(),
+                row, root, comm);
+}
+
+// Sends the rows of CSR block r of `full` (significant on root only) to rank r: the row
+// lengths, column indices and values of each block travel as three Scatterv calls
+template <typename T>
+CsrMatrix<T> scatterCsrRows(const CsrMatrix<T>& full, int cols, const RowPartition& partition, int root,
+                            MPI_Comm comm) {
+    PROFILE_SCOPE(Region::Scatter);
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    std::vector<int> lengths;
+    RowPartition nonzeros;
+    if (rank == root) {
+        lengths.resize(full.rows);
+        for (int i = 0; i < full.rows; ++i) {
+            lengths[i] = full.rowPtr[i + 1] - full.rowPtr[i];
+        }
+        nonzeros = nonzeroPartition(full.rowPtr, partition);
+    }
+    int nnz;
+    MPI_Scatter(nonzeros.counts.data(), 1, MPI_INT, &nnz, 1, MPI_INT, root, comm);
+
+    CsrMatrix<T> local;
+    local.rows = partition.counts[rank];
+    local.cols = cols;
+    local.rowPtr.assign(local.rows + 1, 0);
+    local.colIdx.resize(nnz);
+    local.values.resize(nnz);
+    MPI_Scatterv(lengths.data(), partition.counts.data(), partition.offsets.data(), MPI_INT, local.rowPtr.data() + 1,
+                 local.rows, MPI_INT, root, comm);
+    for (int i = 0; i < local.rows; ++i) {
+        local.rowPtr[i + 1] += local.rowPtr[i];
+    }
+    MPI_Scatterv(full.colIdx.data(), nonzeros.counts.data(), nonzeros.offsets.data(), MPI_INT, local.colIdx.data(), nnz,
+                 MPI_INT, root, comm);
+    MPI_Scatterv(full.values.data(), nonzeros.counts.data(), nonzeros.offsets.data(), mpiType<T>(), local.values.data(),
+                 nnz, mpiType<T>(), root, comm);
+    return local;
+}
+
+// Broadcasts a whole CSR matrix from root; the other ranks' `m` is replaced
+template <typename T>
+void broadcastCsr(CsrMatrix<T>& m, int root, MPI_Comm comm) {
+    PROFILE_SCOPE(Region::Broadcast);
+    int dims[3] = {m.rows, m.cols, m.nnz()};
+    MPI_Bcast(dims, 3, MPI_INT, root, comm);
+    m.rows = dims[0];
+    m.cols = dims[1];
+    m.rowPtr.resize(dims[0] + 1);
+    m.colIdx.resize(dims[2]);
+    m.values.resize(dims[2]);
+    MPI_Bcast(m.rowPtr.data(), dims[0] + 1, MPI_INT, root, comm);
+    MPI_Bcast(m.colIdx.data(), dims[2], MPI_INT, root, comm);
+    MPI_Bcast(m.values.data(), dims[2], mpiType<T>(), root, comm);
+}
+
+// Segment size meaning "send the whole buffer as one message"
+constexpr std::size_t BCAST_SINGLE_MESSAGE = 0;
+
+// Broadcasts `bytes` bytes from root, split into segments of `segment` bytes that are
+// kept in flight a few at a time with MPI_Ibcast (one message if segment is 0)
+void broadcastBytes(void* data, std::size_t bytes, std::size_t segment, int root, MPI_Comm comm);
+
+/*
+ * Measures the broadcast of a message of `bytes` bytes as a single message and with a
+ * range of segment sizes, and returns the fastest segment size (the same on every rank).
+ * Every candidate is timed a few times and its fastest run counts. The result is kept for
+ * the life of the process, per number of ranks, root and power of two of the message size,
+ * so later jobs (the service's in particular) do not measure again. Messages below a few
+ * MB are latency bound and always go out as one message.
+ */
+std::size_t tuneBroadcastSegment(std::size_t bytes, int root, MPI_Comm comm);
+
+// Broadcasts a whole matrix from root; non-root ranks must size `m` first
+template <typename T>
+void broadcastMatrix(Matrix<T>& m, int root, MPI_Comm comm, std::size_t segment = BCAST_SINGLE_MESSAGE) {
+    PROFILE_SCOPE(Region::Broadcast);
+    if (segment == BCAST_SINGLE_MESSAGE) {
+        RowType<T> row(m.cols());
+        MPI_Bcast(m.data(), m.rows(), row, root, comm);
+    } else {
+        broadcastBytes(m.data(), m.size() * sizeof(T), segment, root, comm);
+    }
+}
+
+/*
+ * Two-dimensional Cartesian grid of ranks, with sub-communicators along grid rows
+ * and grid columns. Grid ranks follow the row-major order of the parent communicator.
+ */
+struct ProcessGrid {
+    MPI_Comm comm = MPI_COMM_NULL;
+    MPI_Comm rowComm = MPI_COMM_NULL; // ranks sharing myRow, ordered by column
+    MPI_Comm colComm = MPI_COMM_NULL; // ranks sharing myCol, ordered by row
+    int rows = 0;
+    int cols = 0;
+    int myRow = 0;
+    int myCol = 0;
+
+    // Builds the most square rows x cols grid covering every rank of `comm`
+    static ProcessGrid create(MPI_Comm comm);
+    void free();
+};
+
+/*
+ * 2D block-cyclic layout of a (rows x cols) matrix: square blocks of blockSize
+ * elements are dealt round-robin over the grid rows and grid columns.
+ * Each rank stores its blocks as one dense row-major local matrix.
+ */
+struct BlockCyclicLayout {
+    int rows;
+    int cols;
+    int blockSize;
+
+    int localRows(const ProcessGrid& grid) const { return localCount(rows, blockSize, grid.myRow, grid.rows); }
+    int localCols(const ProcessGrid& grid) const { return localCount(cols, blockSize, grid.myCol, grid.cols); }
+
+    // Number of the n indices dealt in blocks of nb that land on process p out of nprocs
+    static int localCount(int n, int nb, int p, int nprocs);
+};
+
+// Datatype selecting, inside the global row-major matrix, the elements owned by `gridRank`
+MPI_Datatype blockCyclicType(const BlockCyclicLayout& layout, const ProcessGrid& grid, int gridRank, MPI_Datatype element);
+
+// Sends to every rank its block-cyclic part of `full` (significant on root only). The local
+// part travels as rows of a RowType, so that its count stays an int past INT_MAX elements
+// (a 50k x 50k part of a 100k x 100k matrix on 4 ranks).
+template <typename T>
+Matrix<T> scatterBlockCyclic(const Matrix<T>& full, const BlockCyclicLayout& layout, const ProcessGrid& grid, int root) {
+    PROFILE_SCOPE(Region::Scatter);
+    int rank, size;
+    MPI_Comm_rank(grid.comm, &rank);
+    MPI_Comm_size(grid.comm, &size);
+
+    Matrix<T> local(layout.localRows(grid), layout.localCols(grid));
+    RowType<T> row(local.cols());
+    MPI_Request recv;
+    MPI_Irecv(local.data(), local.rows(), row, root, 0, grid.comm, &recv);
+
+    if (rank == root) {
+        std::vector<MPI_Datatype> types(size);
+        std::vector<MPI_Request> sends(size);
+        for (int r = 0; r < size; ++r) {
+            types[r] = blockCyclicType(layout, grid, r, mpiType<T>());
+            MPI_Isend(full.data(), 1, types[r], r, 0, grid.comm, &sends[r]);
+        }
+        MPI_Waitall(size, sends.data(), MPI_STATUSES_IGNORE);
+        for (MPI_Datatype& type : types) {
+            MPI_Type_free(&type);
+        }
+    }
+    MPI_Wait(&recv, MPI_STATUS_IGNORE);
+    return local;
+}
+
+// Collects every block-cyclic local part into `full` on root (which must already be sized);
+// the parts are sent in rows, like scatterBlockCyclic receives them
+template <typename T>
+void gatherBlockCyclic(const Matrix<T>& local, Matrix<T>& full, const BlockCyclicLayout& layout, const ProcessGrid& grid,
+                       int root) {
+    PROFILE_SCOPE(Region::Gather);
+    int rank, size;
+    MPI_Comm_rank(grid.comm, &rank);
+    MPI_Comm_size(grid.comm, &size);
+
+    std::vector<MPI_Datatype> types;
+    std::vector<MPI_Request> recvs;
+    if (rank == root) {
+        types.resize(size);
+        recvs.resize(size);
+        for (int r = 0; r < size; ++r) {
+            types[r] = blockCyclicType(layout, grid, r, mpiType<T>());
+            MPI_Irecv(full.data(), 1, types[r], r, 0, grid.comm, &recvs[r]);
+        }
+    }
+    RowType<T> row(local.cols());
+    MPI_Send(local.data(), local.rows(), row, root, 0, grid.comm);
+    if (rank == root) {
+        MPI_Waitall(size, recvs.data(), MPI_STATUSES_IGNORE);
+        for (MPI_Datatype& type : types) {
+            MPI_Type_free(&type);
+        }
+    }
+}
+
+#endif // DISTRIBUTION_H
@@ -0,0 +1,70 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+
+// Instruction sets with a dedicated int32 micro-kernel
+enum class Isa { Scalar, Avx2, Avx512 };
+
+const char* isaName(Isa isa);
+
+// Best instruction set supported by the host CPU (queried through CPUID): every feature its
+// kernels are compiled for, i.e. AVX2 + FMA, or AVX-512 F/BW/DQ on top of them
+Isa detectIsa();
+bool isaSupported(Isa isa);
+
+// Instruction set used by multiplyMatrices: detectIsa(), unless lowered through
+// $MATMUL_ISA (scalar, avx2, avx512) or setIsa(). Unsupported requests are ignored.
+Isa activeIsa();
+bool setIsa(Isa isa);
+
+/*
+ * Block kernel: C[mb x nb] += A[mb x kb] * B[kb x nb], all row-major with the given
+ * leading dimensions. The SIMD variants keep a 4-row register tile of C in
+ * accumulators and broadcast one element of A per row against full vectors of B.
+ */
+using BlockKernel = void (*)(const int* A, std::ptrdiff_t lda, const int* B, std::ptrdiff_t ldb, int* C,
+                             std::ptrdiff_t ldc, int mb, int nb, int kb);
+
+void blockKernelScalar(const int* A, std::ptrdiff_t lda, const int* B, std::ptrdiff_t ldb, int* C,
+                       std::ptrdiff_t ldc, int mb, int nb, int kb);
+void blockKernelAvx2(const int* A, std::ptrdiff_t lda, const int* B, std::ptrdiff_t ldb, int* C,
+                     std::ptrdiff_t ldc, int mb, int nb, int kb);
+void blockKernelAvx512(const int* A, std::ptrdiff_t lda, const int* B, std::ptrdiff_t ldb, int* C,
+                       std::ptrdiff_t ldc, int mb, int nb, int kb);
+
+BlockKernel blockKernel(Isa isa);
+
+/*
+ * Block kernel for T elements accumulated in Acc: C[mb x nb] += A[mb x kb] * B[kb x nb],
+ * with every element of A and B widened to Acc before the multiply. Each supported
+ * (T, Acc) pair is compiled once per instruction set from the same template, which the
+ * compiler vectorizes for that ISA; <int, int> maps to the hand-written kernels above.
+ */
+template <typename T, typename Acc>
+using BlockKernelOf = void (*)(const T* A, std::ptrdiff_t lda, const T* B, std::ptrdiff_t ldb, Acc* C,
+                               std::ptrdiff_t ldc, int mb, int nb, int kb);
+
+template <typename T, typename Acc>
+BlockKernelOf<T, Acc> blockKernelFor(Isa isa);
+
+/*
+ * Streaming kernels for the vector shapes, which read the large operand exactly once:
+ *  - GEMV: y[i * incy] += sum_k A[i x k] * x[k] for m rows, with x already widened to Acc;
+ *    4 rows share every vector load of x
+ *  - AXPY: y[n] += alpha * x[n] (or y[n] = alpha * x[n] with overwrite), the building block of the vector-matrix product (one row
+ *    of B per element of the vector) and of the rank-1 outer product (one row of C per
+ *    element of the column)
+ */
+template <typename T, typename Acc>
+using GemvKernelOf = void (*)(const T* A, std::ptrdiff_t lda, const Acc* x, Acc* y, std::ptrdiff_t incy, int m,
+                              int k);
+template <typename T, typename Acc>
+using AxpyKernelOf = void (*)(Acc alpha, const T* x, Acc* y, int n, bool overwrite);
+
+template <typename T, typename Acc>
+GemvKernelOf<T, Acc> gemvKernelFor(Isa isa);
+template <typename T, typename Acc>
+AxpyKernelOf<T, Acc> axpyKernelFor(Isa isa);
+
+#endif // KERNELS_H
@@ -0,0 +1,209 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Alignment (in bytes) of every buffer owned by a Matrix: one cache line, which is
+// also wide enough for full-width AVX-512 loads
+constexpr std::size_t MATRIX_ALIGNMENT = 64;
+
+/*
+ * Non-owning row-major view over a rectangular block of elements.
+ * Consecutive rows are `stride` elements apart, so a view can describe a whole
+ * matrix or any sub-block of it without copying.
+ */
+template <typename T>
+class MatrixView {
+public:
+    MatrixView() = default;
+
+    MatrixView(T* data, int rows, int cols, std::ptrdiff_t stride)
+        : data_(data), rows_(rows), cols_(cols), stride_(stride) {}
+
+    MatrixView(T* data, int rows, int cols) : MatrixView(data, rows, cols, cols) {}
+
+    // Allows MatrixView<int> -> MatrixView<const int>
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    MatrixView(const MatrixView<U>& other)
+        : data_(other.data()), rows_(other.rows()), cols_(other.cols()), stride_(other.stride()) {}
+
+    T* data() const { return data_; }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    std::ptrdiff_t stride() const { return stride_; }
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+    bool contiguous() const { return stride_ == cols_ || rows_ <= 1; }
+
+    T* row(int i) const { return data_ + i * stride_; }
+    T& operator()(int i, int j) const { return data_[i * stride_ + j]; }
+
+    MatrixView block(int row, int col, int rows, int cols) const {
+        return MatrixView(data_ + row * stride_ + col, rows, cols, stride_);
+    }
+
+    MatrixView rowBlock(int row, int rows) const { return block(row, 0, rows, cols_); }
+
+private:
+    T* data_ = nullptr;
+    int rows_ = 0;
+    int cols_ = 0;
+    std::ptrdiff_t stride_ = 0;
+};
+
+template <typename T>
+using ConstMatrixView = MatrixView<const T>;
+
+/*
+ * Dense row-major matrix stored in a single MATRIX_ALIGNMENT-aligned buffer.
+ * The stride defaults to the number of columns, so the whole matrix is one
+ * contiguous block that can be sent with a single MPI transfer.
+ */
+template <typename T>
+class Matrix {
+    static_assert(std::is_trivially_copyable_v<T>, "Matrix elements must be trivially copyable");
+
+public:
+    Matrix() = default;
+
+    Matrix(int rows, int cols) : Matrix(rows, cols, cols) {}
+
+    Matrix(int rows, int cols, std::ptrdiff_t stride)
+        : data_(allocate(checkedCount(rows, cols, stride))), rows_(rows), cols_(cols), stride_(stride) {
+        std::fill_n(data_.get(), static_cast<std::size_t>(rows) * stride, T());
+    }
+
+    Matrix(const Matrix& other) : Matrix(other.rows_, other.cols_, other.stride_) {
+        std::copy_n(other.data_.get(), other.size(), data_.get());
+    }
+
+    Matrix(Matrix&& other) noexcept
+        : data_(std::move(other.data_)), rows_(std::exchange(other.rows_, 0)), cols_(std::exchange(other.cols_, 0)),
+          stride_(std::exchange(other.stride_, 0)) {}
+
+    Matrix& operator=(const Matrix& other) {
+        if (this != &other) {
+            *this = Matrix(other);
+        }
+        return *this;
+    }
+
+    Matrix& operator=(Matrix&& other) noexcept {
+        data_ = std::move(other.data_);
+        rows_ = std::exchange(other.rows_, 0);
+        cols_ = std::exchange(other.cols_, 0);
+        stride_ = std::exchange(other.stride_, 0);
+        return *this;
+    }
+
+    // Takes ownership of an external buffer of at least rows * stride elements (for example a
+    // memory-mapped file); `release` runs instead of the aligned free when the matrix is destroyed
+    static Matrix adopt(T* data, int rows, int cols, std::ptrdiff_t stride, std::function<void()> release) {
+        checkedCount(rows, cols, stride);
+        Matrix m;
+        m.data_ = Buffer(data, Deleter{std::move(release)});
+        m.rows_ = rows;
+        m.cols_ = cols;
+        m.stride_ = stride;
+        return m;
+    }
+
+    static Matrix fromNested(const std::vector<std::vector<T>>& nested, int rows, int cols) {
+        Matrix m(rows, cols);
+        for (int i = 0; i < rows; ++i) {
+            std::copy_n(nested[i].begin(), cols, m.row(i));
+        }
+        return m;
+    }
+
+    void copyToNested(std::vector<std::vector<T>>& nested) const {
+        for (int i = 0; i < rows_; ++i) {
+            std::copy_n(row(i), cols_, nested[i].begin());
+        }
+    }
+
+    T* data() { return data_.get(); }
+    const T* data() const { return data_.get(); }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    std::ptrdiff_t stride() const { return stride_; }
+    std::size_t size() const { return static_cast<std::size_t>(rows_) * stride_; }
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+
+    T* row(int i) { return data_.get() + i * stride_; }
+    const T* row(int i) const { return data_.get() + i * stride_; }
+    T& operator()(int i, int j) { return data_[i * stride_ + j]; }
+    const T& operator()(int i, int j) const { return data_[i * stride_ + j]; }
+
+    MatrixView<T> view() { return MatrixView<T>(data(), rows_, cols_, stride_); }
+    ConstMatrixView<T> view() const { return ConstMatrixView<T>(data(), rows_, cols_, stride_); }
+    operator MatrixView<T>() { return view(); }
+    operator ConstMatrixView<T>() const { return view(); }
+
+    MatrixView<T> block(int row, int col, int rows, int cols) { return view().block(row, col, rows, cols); }
+    ConstMatrixView<T> block(int row, int col, int rows, int cols) const {
+        return view().block(row, col, rows, cols);
+    }
+
+    bool operator==(const Matrix& other) const {
+        if (rows_ != other.rows_ || cols_ != other.cols_) {
+            return false;
+        }
+        for (int i = 0; i < rows_; ++i) {
+            if (!std::equal(row(i), row(i) + cols_, other.row(i))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const Matrix& other) const { return !(*this == other); }
+
+private:
+    struct Deleter {
+        std::function<void()> release;
+
+        void operator()(T* p) const {
+            if (release) {
+                release();
+            } else {
+                std::free(p);
+            }
+        }
+    };
+    using Buffer = std::unique_ptr<T[], Deleter>;
+
+    static std::size_t checkedCount(int rows, int cols, std::ptrdiff_t stride) {
+        if (rows < 0 || cols < 0 || stride < cols) {
+            throw std::invalid_argument("Invalid matrix dimensions");
+        }
+        return static_cast<std::size_t>(rows) * stride;
+    }
+
+    static T* allocate(std::size_t count) {
+        if (count == 0) {
+            return nullptr;
+        }
+        std::size_t bytes = (count * sizeof(T) + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT * MATRIX_ALIGNMENT;
+        void* p = std::aligned_alloc(MATRIX_ALIGNMENT, bytes);
+        if (p == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(p);
+    }
+
+    Buffer data_;
+    int rows_ = 0;
+    int cols_ = 0;
+    std::ptrdiff_t stride_ = 0;
+};
+
+#endif // MATRIX_H
@@ -0,0 +1,106 @@
+#ifndef MATRIX_IO_H
+#define MATRIX_IO_H
+
+#include "matrix.h"
+#include "sparse.h"
+#include <cstdint>
+#include <string>
+
+/*
+ * Binary matrix file: a 64-byte header followed by the elements in row-major order,
+ * in host (little-endian) byte order. The payload starts 64 bytes into the file, so a
+ * page-aligned mapping of the file gives a MATRIX_ALIGNMENT-aligned matrix buffer.
+ */
+enum class DType : std::uint8_t { Int8 = 1, Int16 = 2, Int32 = 3, Int64 = 4, Float32 = 5, Float64 = 6 };
+enum class Layout : std::uint8_t { RowMajor = 0 };
+
+struct MatrixFileHeader {
+    char magic[4];          // "MMAT"
+    std::uint16_t version;  // MATRIX_FILE_VERSION
+    DType dtype;
+    Layout layout;
+    std::int64_t rows;
+    std::int64_t cols;
+    std::uint64_t checksum; // FNV-1a of the payload bytes
+    std::uint8_t flags;     // MATRIX_FILE_* flags
+    char reserved[31];
+};
+static_assert(sizeof(MatrixFileHeader) == 64, "Matrix file header must stay 64 bytes");
+
+constexpr std::uint16_t MATRIX_FILE_VERSION = 1;
+
+// Element type stored for a C++ type (one of int8/16/32/64_t, float, double)
+template <typename T>
+constexpr DType dtypeOf();
+template <> constexpr DType dtypeOf<std::int8_t>() { return DType::Int8; }
+template <> constexpr DType dtypeOf<std::int16_t>() { return DType::Int16; }
+template <> constexpr DType dtypeOf<std::int32_t>() { return DType::Int32; }
+template <> constexpr DType dtypeOf<std::int64_t>() { return DType::Int64; }
+template <> constexpr DType dtypeOf<float>() { return DType::Float32; }
+template <> constexpr DType dtypeOf<double>() { return DType::Float64; }
+
+// Names used on the command line: int8, int16, int32, int64, float32, float64
+const char* dtypeName(DType dtype);
+bool parseDType(const std::string& name, DType& dtype);
+std::size_t dtypeSize(DType dtype);
+
+// Set by writers that never see the whole payload (collective MPI-IO writes): the
+// checksum field is meaningless and verification is skipped
+constexpr std::uint8_t MATRIX_FILE_NO_CHECKSUM = 1;
+
+// All functions below throw std::runtime_error on I/O or format errors
+
+// Text format: "rows cols" on the first line, then the elements row by row.
+// The reader parses large blocks with std::from_chars; with threads > 1, files laid out
+// one row per line are parsed in parallel, split on line boundaries.
+// Text files always hold int values; the writers also print the other element types.
+Matrix<int> readMatrixText(const std::string& path, int threads = 1);
+template <typename T>
+void writeMatrixText(const std::string& path, ConstMatrixView<T> matrix);
+
+// Writes the rows as "v v v \n" lines, the layout main prints its result in. Elements are
+// formatted with std::to_chars into a large buffer that is flushed with block writes.
+template <typename T>
+void printMatrix(int fd, ConstMatrixView<T> matrix);
+
+// Reads a dense text file into CSR without ever storing its zeros
+CsrMatrix<int> readMatrixTextSparse(const std::string& path);
+
+// Matrix Market coordinate files ("%%MatrixMarket matrix coordinate integer|pattern
+// general|symmetric|skew-symmetric"): 1-based "row col [value]" entries, read into CSR
+bool isMatrixMarketFile(const std::string& path);
+CsrMatrix<int> readMatrixMarket(const std::string& path);
+
+bool isBinaryMatrixFile(const std::string& path);
+MatrixFileHeader makeMatrixHeader(int rows, int cols, DType dtype = DType::Int32);
+MatrixFileHeader readMatrixHeader(const std::string& path);
+// Checks that a binary file of any element type holds its whole payload and, unless it was
+// written without one, that the payload matches the checksum of the header. The payload is
+// streamed rather than mapped, for inputs that are then read collectively with MPI-IO.
+void verifyMatrixFile(const std::string& path);
+template <typename T>
+void writeMatrixBinary(const std::string& path, ConstMatrixView<T> matrix);
+
+// Maps a binary file privately (copy-on-write) and wraps the mapping in a Matrix without
+// copying; the pages are read lazily on first touch. `verify` checks the payload checksum.
+// The file must hold elements of type T.
+template <typename T = int>
+Matrix<T> mapMatrixBinary(const std::string& path, bool verify = false);
+
+// int overloads, so that Matrix<int> arguments convert to views without naming the type
+inline void writeMatrixText(const std::string& path, ConstMatrixView<int> matrix) {
+    writeMatrixText<int>(path, matrix);
+}
+inline void printMatrix(int fd, ConstMatrixView<int> matrix) {
+    printMatrix<int>(fd, matrix);
+}
+inline void writeMatrixBinary(const std::string& path, ConstMatrixView<int> matrix) {
+    writeMatrixBinary<int>(path, matrix);
+}
+
+// Reads either format, chosen by the file magic
+Matrix<int> readMatrix(const std::string& path, bool verify = false, int threads = 1);
+
+std::uint64_t checksumBytes(const void* data, std::size_t bytes, std::uint64_t seed = 14695981039346656037ull);
+
+#endif // MATRIX_IO_H
@@ -1,8 +1,64 @@
 #ifndef MATRIX_MULTIPLICATION_H
 #define MATRIX_MULTIPLICATION_H
 
+#include "kernels.h"
+#include "matrix.h"
+#include "tiling.h"
+#include <cstdint>
 #include <vector>
 
+/*
+ * Element and accumulator types the multiplication is compiled for:
+ *   int8  -> int32, int64      int16 -> int32, int64      int32 -> int32, int64
+ *   int64 -> int64             float -> float, double     double -> double
+ * Inputs of type T are widened to Acc before every multiply, so narrow inputs can be
+ * summed without overflow. AccumulatorOf<T> is the default pick: int32 for the narrow
+ * integer types and T itself otherwise.
+ */
+template <typename T>
+struct Accumulator {
+    using type = T;
+};
+template <> struct Accumulator<std::int8_t> { using type = std::int32_t; };
+template <> struct Accumulator<std::int16_t> { using type = std::int32_t; };
+
+template <typename T>
+using AccumulatorOf = typename Accumulator<T>::type;
+
+/*
+ * Computes C = A * B on contiguous row-major storage.
+ * A is (rows x k), B is (k x cols) and C must be (rows x cols); any stride is accepted.
+ */
+template <typename T, typename Acc = AccumulatorOf<T>>
+void multiplyMatrices(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C);
+
+// Computes C += A * B with the same kernel
+template <typename T, typename Acc = AccumulatorOf<T>>
+void multiplyAccumulate(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C);
+
+// Cache-blocked i-k-j kernel behind multiplyMatrices, with explicit tile sizes
+template <typename T, typename Acc = AccumulatorOf<T>>
+void multiplyMatricesBlocked(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C, const TileSizes& tiles);
+template <typename T, typename Acc = AccumulatorOf<T>>
+void multiplyAccumulateBlocked(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C, const TileSizes& tiles);
+
+// int overloads, so that Matrix<int> arguments convert to views without naming the types
+inline void multiplyMatrices(ConstMatrixView<int> A, ConstMatrixView<int> B, MatrixView<int> C) {
+    multiplyMatrices<int, int>(A, B, C);
+}
+inline void multiplyAccumulate(ConstMatrixView<int> A, ConstMatrixView<int> B, MatrixView<int> C) {
+    multiplyAccumulate<int, int>(A, B, C);
+}
+inline void multiplyMatricesBlocked(ConstMatrixView<int> A, ConstMatrixView<int> B, MatrixView<int> C,
+                                    const TileSizes& tiles) {
+    multiplyMatricesBlocked<int, int>(A, B, C, tiles);
+}
+inline void multiplyAccumulateBlocked(ConstMatrixView<int> A, ConstMatrixView<int> B, MatrixView<int> C,
+                                      const TileSizes& tiles) {
+    multiplyAccumulateBlocked<int, int>(A, B, C, tiles);
+}
+
+// Legacy nested-vector interface, kept as a thin adapter over the overload above
 void multiplyMatrices(const std::vector<std::vector<int>>& A, const std::vector<std::vector<int>>& B, std::vector<std::vector<int>>& C, int rowsA, int colsA, int colsB);
 
-#endif // MATRIX_MULTIPLICATION_H
\ No newline at end of file
+#endif // MATRIX_MULTIPLICATION_H
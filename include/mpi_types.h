@@ -0,0 +1,18 @@
+#ifndef MPI_TYPES_H
+#define MPI_TYPES_H
+
+#include <mpi.h>
+#include <cstdint>
+
+// MPI datatype matching a C++ element type
+template <typename T>
+MPI_Datatype mpiType();
+
+template <> inline MPI_Datatype mpiType<std::int8_t>() { return MPI_INT8_T; }
+template <> inline MPI_Datatype mpiType<std::int16_t>() { return MPI_INT16_T; }
+template <> inline MPI_Datatype mpiType<std::int32_t>() { return MPI_INT32_T; }
+template <> inline MPI_Datatype mpiType<std::int64_t>() { return MPI_INT64_T; }
+template <> inline MPI_Datatype mpiType<float>() { return MPI_FLOAT; }
+template <> inline MPI_Datatype mpiType<double>() { return MPI_DOUBLE; }
+
+#endif // MPI_TYPES_H
@@ -0,0 +1,43 @@
+#ifndef PARALLEL_IO_H
+#define PARALLEL_IO_H
+
+#include "distribution.h"
+#include "matrix.h"
+#include <mpi.h>
+#include <string>
+
+/*
+ * Collective MPI-IO readers for binary matrix files (see matrix_io.h).
+ * Every rank of the communicator must call them; each rank sets a file view that
+ * selects only the elements it owns and pulls them with MPI_File_read_at_all, so no
+ * rank ever reads or forwards another rank's data. The dimensions and the element
+ * type T must come from the file header. They throw std::runtime_error if the file
+ * cannot be read or is shorter than its header says. They do not check the checksum,
+ * which no rank could compute from its own part (verifyMatrixFile does, beforehand).
+ */
+
+// Rank r reads the rows of `partition` block r
+template <typename T = int>
+Matrix<T> readRowBlockAll(const std::string& path, int rows, int cols, const RowPartition& partition, MPI_Comm comm);
+
+// Every rank reads the whole matrix
+template <typename T = int>
+Matrix<T> readMatrixAll(const std::string& path, int rows, int cols, MPI_Comm comm);
+
+// Every rank reads its block-cyclic local part
+template <typename T = int>
+Matrix<T> readBlockCyclicAll(const std::string& path, const BlockCyclicLayout& layout, const ProcessGrid& grid);
+
+/*
+ * Collective writers: the matrix is stored as a binary file without ever being gathered.
+ * Rank 0 writes the header (flagged MATRIX_FILE_NO_CHECKSUM, as no rank sees the whole
+ * payload) and every rank writes its own part with MPI_File_write_at_all.
+ */
+template <typename T>
+void writeRowBlockAll(const std::string& path, const Matrix<T>& local, int rows, const RowPartition& partition,
+                      MPI_Comm comm);
+template <typename T>
+void writeBlockCyclicAll(const std::string& path, const Matrix<T>& local, const BlockCyclicLayout& layout,
+                         const ProcessGrid& grid);
+
+#endif // PARALLEL_IO_H
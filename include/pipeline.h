@@ -0,0 +1,28 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "distribution.h"
+#include "matrix.h"
+
+// Column panels of the pipelined product for a B with `cols` columns, when no width is
+// given: about 8 panels, each a multiple of 64 columns wide
+int pipelinePanelWidth(int cols);
+
+/*
+ * Row-block product with the communication overlapped with the compute. B is split into
+ * column panels of `panelWidth` columns: with broadcastB, the panels are broadcast from
+ * root with MPI_Ibcast, panel k + 1 travelling while panel k is multiplied; otherwise B is
+ * already complete on every rank. localC = localA * B is computed panel by panel, and with
+ * gather every finished (local rows x panel) block of C is sent to root with MPI_Isend
+ * while the next panels are computed; root receives them straight into C (sized by the
+ * caller, significant on root only). Between row chunks of a panel the outstanding
+ * transfers are tested, so that they progress without an asynchronous progress thread.
+ * With structure, every (row chunk x panel) product is tried with multiplyStructured first.
+ * Returns the time this rank spent blocked waiting for transfers.
+ */
+template <typename T, typename Acc>
+double multiplyPipelined(ConstMatrixView<T> localA, ConstMatrixView<T> B, MatrixView<Acc> localC, Matrix<Acc>& C,
+                         const RowPartition& rows, int panelWidth, bool broadcastB, bool gather, bool structure,
+                         int root, MPI_Comm comm);
+
+#endif // PIPELINE_H
@@ -0,0 +1,143 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <mpi.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Profiling of the hot paths. The library wraps file reads and writes, every collective
+ * and the local multiply in PROFILE_SCOPE regions; while profiling is on (setProfiling),
+ * each region adds up its calls, its seconds, the operations of its multiplies (2 M N K)
+ * and, when the kernel lets the process open them, hardware counters of the thread that
+ * turned profiling on. A scope nested in one of the same region counts once, at the
+ * outermost. Off, a scope costs one test of a flag; built with -DMATMUL_PROFILE=OFF the
+ * scopes compile to nothing.
+ */
+enum class Region { Read, Write, Scatter, Broadcast, Gather, Allgather, Wait, Multiply };
+constexpr int REGION_COUNT = 8;
+
+const char* regionName(Region region);
+
+// Hardware counters of a region: CPU cycles, instructions and last level cache misses
+constexpr int COUNTER_COUNT = 3;
+const char* counterName(int counter);
+
+struct RegionProfile {
+    std::uint64_t calls = 0;
+    double seconds = 0.0;
+    double operations = 0.0;
+    std::uint64_t counters[COUNTER_COUNT] = {};
+};
+
+/*
+ * Turns profiling on or off and clears the regions. With counters, the hardware counters
+ * of the calling thread are opened with perf_event_open; returns false if they cannot be
+ * (no PMU in the VM, perf_event_paranoid too strict), in which case the regions are still
+ * timed without them.
+ */
+bool setProfiling(bool enabled, bool counters = false);
+bool profilingEnabled();
+// Hardware counters are being read
+bool profilingCounters();
+RegionProfile regionProfile(Region region);
+
+/*
+ * Timeline of a job: while tracing is on (setTracing), every outermost region scope also
+ * records an event with its begin and end on the steady clock and the thread it ran on,
+ * and the blocked kernel records one "tile" event per tile of C on the pool thread that
+ * computed it. Events past TRACE_MAX_EVENTS are dropped and counted.
+ */
+constexpr int TRACE_TILE = REGION_COUNT; // event name after the regions
+constexpr std::size_t TRACE_MAX_EVENTS = std::size_t(1) << 20;
+
+struct TraceEvent {
+    int name; // a Region, or TRACE_TILE
+    int thread; // 0 for the thread that turned tracing on, then in order of first event
+    double begin; // seconds on the steady clock
+    double end;
+};
+
+// Turns tracing on or off and clears the events
+void setTracing(bool enabled);
+bool tracingEnabled();
+std::vector<TraceEvent> traceEvents();
+std::size_t droppedTraceEvents();
+
+class ProfileScope {
+public:
+    explicit ProfileScope(Region region, double operations = 0.0);
+    ~ProfileScope();
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Region region_;
+    bool active_ = false;
+    bool outermost_ = false;
+    bool profiling_ = false;
+    bool tracing_ = false;
+    bool counting_ = false;
+    double operations_;
+    std::chrono::steady_clock::time_point start_;
+    std::uint64_t counters_[COUNTER_COUNT] = {};
+};
+
+// A tile of the blocked kernel, recorded only while tracing
+class TileScope {
+public:
+    TileScope();
+    ~TileScope();
+    TileScope(const TileScope&) = delete;
+    TileScope& operator=(const TileScope&) = delete;
+
+private:
+    bool tracing_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#ifdef MATMUL_PROFILE
+#define PROFILE_SCOPE(...) ProfileScope profileScope(__VA_ARGS__)
+#define TILE_SCOPE() TileScope tileScope
+#else
+#define PROFILE_SCOPE(...)
+#define TILE_SCOPE()
+#endif
+
+/*
+ * The regions of every rank of comm, reduced on root: calls, seconds, operations and
+ * counters summed in `total`, and the fastest and slowest rank of every region. `counters`
+ * is set when all ranks read hardware counters.
+ */
+struct ProfileSummary {
+    int ranks = 0;
+    bool counters = false;
+    RegionProfile total[REGION_COUNT];
+    double minSeconds[REGION_COUNT] = {};
+    double maxSeconds[REGION_COUNT] = {};
+};
+
+// Collective over comm; the summary is significant on root only
+ProfileSummary reduceProfile(int root, MPI_Comm comm);
+
+// One line holding the regions that ran: calls, slowest rank, and the operation rate and
+// counters where there are any
+std::string profileLine(const ProfileSummary& summary);
+// The summary as a JSON document; returns false if path cannot be written
+bool writeProfileJson(const std::string& path, const ProfileSummary& summary);
+
+/*
+ * Merges the events of every rank of comm into one Chrome trace (JSON object format, for
+ * chrome://tracing or ui.perfetto.dev) written by root, one process per rank and one
+ * thread per pool thread. Every rank moves its events from the steady clock to MPI_Wtime,
+ * and root measures the offset of each rank's MPI_Wtime to its own with a few round trips,
+ * keeping the one of the shortest, so the ranks share one time axis even when the clocks
+ * of the nodes differ. Collective over comm; returns false on root if path cannot be
+ * written.
+ */
+bool writeTrace(const std::string& path, int root, MPI_Comm comm);
+
+#endif // PROFILE_H
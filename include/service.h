@@ -0,0 +1,126 @@
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include "matrix.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+/*
+ * Service mode of main: the ranks stay up and rank 0 takes jobs from a local UNIX socket.
+ * A request is the command line of one job, one argument per line and an empty line at
+ * the end; the reply is a single line, "ok ..." or "error: ...". All functions below
+ * throw std::runtime_error on socket errors.
+ */
+
+// Time a client of the service has to send its whole request
+constexpr int REQUEST_TIMEOUT_MS = 10000;
+
+// Listening socket at path; a stale socket file left by an earlier service is replaced
+int listenSocket(const std::string& path);
+// Next client of a listening socket
+int acceptClient(int listener);
+// Makes the reads from fd below fail once no data has come for `milliseconds`
+void setReadTimeout(int fd, int milliseconds);
+// Client side: connects to the service listening at path
+int connectSocket(const std::string& path);
+
+void writeRequest(int fd, const std::vector<std::string>& args);
+std::vector<std::string> readRequest(int fd);
+void writeReply(int fd, const std::string& reply);
+std::string readReply(int fd);
+
+/*
+ * Key of a matrix file in the cache: the path with the size and modification time of the
+ * file, so that a file rewritten between two jobs is loaded again. Empty if the file
+ * cannot be examined.
+ */
+std::string fileCacheKey(const std::string& path);
+
+/*
+ * Matrices kept between the jobs of the service, least recently used first out once they
+ * take more than `capacity` bytes. Used for B in the row-block product, which every rank
+ * holds in full: each rank keeps its own cache, and since all ranks run the same jobs in
+ * the same order their caches always hold the same keys.
+ */
+class MatrixCache {
+public:
+    explicit MatrixCache(std::size_t capacity) : capacity_(capacity) {}
+
+    // The matrix stored under key with element type T, or nullptr
+    template <typename T>
+    std::shared_ptr<const Matrix<T>> find(const std::string& key) {
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->key == key && *it->type == typeid(T)) {
+                entries_.splice(entries_.begin(), entries_, it);
+                ++hits_;
+                return std::static_pointer_cast<const Matrix<T>>(it->matrix);
+            }
+        }
+        ++misses_;
+        return nullptr;
+    }
+
+    // Like find, but leaves the order and the hit counts alone
+    template <typename T>
+    std::shared_ptr<const Matrix<T>> peek(const std::string& key) const {
+        for (const Entry& entry : entries_) {
+            if (entry.key == key && *entry.type == typeid(T)) {
+                return std::static_pointer_cast<const Matrix<T>>(entry.matrix);
+            }
+        }
+        return nullptr;
+    }
+
+    // Stores m under key, evicting the least recently used matrices to make room; a
+    // matrix larger than the whole cache is not stored
+    template <typename T>
+    void insert(const std::string& key, std::shared_ptr<const Matrix<T>> m) {
+        const std::size_t bytes = m->size() * sizeof(T);
+        if (key.empty() || bytes > capacity_) {
+            return;
+        }
+        erase(key);
+        while (bytes_ + bytes > capacity_) {
+            bytes_ -= entries_.back().bytes;
+            entries_.pop_back();
+        }
+        entries_.push_front(Entry{key, &typeid(T), bytes, std::move(m)});
+        bytes_ += bytes;
+    }
+
+    std::size_t matrices() const { return entries_.size(); }
+    std::size_t bytes() const { return bytes_; }
+    std::uint64_t hits() const { return hits_; }
+    std::uint64_t misses() const { return misses_; }
+
+private:
+    struct Entry {
+        std::string key;
+        const std::type_info* type;
+        std::size_t bytes;
+        std::shared_ptr<const void> matrix;
+    };
+
+    void erase(const std::string& key) {
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->key == key) {
+                bytes_ -= it->bytes;
+                entries_.erase(it);
+                return;
+            }
+        }
+    }
+
+    std::size_t capacity_;
+    std::size_t bytes_ = 0;
+    std::uint64_t hits_ = 0;
+    std::uint64_t misses_ = 0;
+    std::list<Entry> entries_; // most recently used first
+};
+
+#endif // SERVICE_H
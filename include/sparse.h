@@ -0,0 +1,71 @@
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include "matrix.h"
+#include <vector>
+
+/*
+ * Compressed sparse row matrix: the nonzeros of row i are values[rowPtr[i] .. rowPtr[i + 1])
+ * at columns colIdx[...], in increasing column order. Only the nonzeros are stored, so
+ * memory and multiplication time scale with nnz() instead of rows * cols.
+ */
+template <typename T>
+struct CsrMatrix {
+    int rows = 0;
+    int cols = 0;
+    std::vector<int> rowPtr = {0};
+    std::vector<int> colIdx;
+    std::vector<T> values;
+
+    int nnz() const { return static_cast<int>(values.size()); }
+};
+
+// Compressed sparse column matrix: the same layout as CsrMatrix with the roles of rows and
+// columns swapped (column j holds rowIdx/values[colPtr[j] .. colPtr[j + 1]))
+template <typename T>
+struct CscMatrix {
+    int rows = 0;
+    int cols = 0;
+    std::vector<int> colPtr = {0};
+    std::vector<int> rowIdx;
+    std::vector<T> values;
+
+    int nnz() const { return static_cast<int>(values.size()); }
+};
+
+// Fraction of nonzero elements (0 for an empty matrix)
+template <typename T>
+double density(ConstMatrixView<T> dense);
+
+template <typename T>
+CsrMatrix<T> toCsr(ConstMatrixView<T> dense);
+template <typename T>
+CscMatrix<T> toCsc(const CsrMatrix<T>& sparse);
+template <typename T>
+Matrix<T> toDense(const CsrMatrix<T>& sparse);
+
+// Builds a CSR matrix from (row, col, value) triplets in any order; duplicates are summed
+// and explicit zeros are dropped. Throws std::invalid_argument on out-of-range indices.
+template <typename T>
+CsrMatrix<T> csrFromTriplets(int rows, int cols, const std::vector<int>& rowIndex, const std::vector<int>& colIndex,
+                             const std::vector<T>& values);
+
+/*
+ * Sparse kernels, all taking A (rows x k) and B (k x cols) and writing every element of C.
+ * The row loops run on the ThreadPool like the dense kernel.
+ *  - multiplySparseDense (SpMM): each nonzero a_ik adds a_ik * B[k, :] to C[i, :]
+ *  - multiplyDenseSparse: C[i, j] is the sparse dot product of row i of A with column j of B
+ *  - multiplySparse (SpGEMM): Gustavson's row-by-row product with a dense accumulator per
+ *    row, run twice (count, then fill) so the result is allocated once
+ */
+template <typename T, typename Acc>
+void multiplySparseDense(const CsrMatrix<T>& A, ConstMatrixView<T> B, MatrixView<Acc> C);
+template <typename T, typename Acc>
+void multiplyDenseSparse(ConstMatrixView<T> A, const CscMatrix<T>& B, MatrixView<Acc> C);
+template <typename T, typename Acc>
+CsrMatrix<Acc> multiplySparse(const CsrMatrix<T>& A, const CsrMatrix<T>& B);
+
+// Inputs with a density below this go through the sparse kernels in main
+constexpr double SPARSE_DENSITY_THRESHOLD = 0.05;
+
+#endif // SPARSE_H
@@ -0,0 +1,60 @@
+#ifndef STRASSEN_H
+#define STRASSEN_H
+
+#include "matrix.h"
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+/*
+ * Scratch memory for the Strassen-Winograd recursion, allocated once up front.
+ * It holds the zero-padded copies of A, B and C (when a dimension does not halve
+ * evenly down to the cutoff) and two temporaries per recursion level, so the
+ * recursion itself never allocates. Reusing one workspace for repeated products
+ * of the same shape means no allocation after the first call.
+ */
+class StrassenWorkspace {
+public:
+    StrassenWorkspace() = default;
+    StrassenWorkspace(int M, int K, int N, int cutoff) { reserve(M, K, N, cutoff); }
+
+    // Grows the arena to fit an (M x K) * (K x N) product; never shrinks it
+    void reserve(int M, int K, int N, int cutoff);
+    std::size_t capacity() const { return capacity_; }
+    int* data() { return data_.get(); }
+
+private:
+    struct Free {
+        void operator()(int* p) const { std::free(p); }
+    };
+
+    std::unique_ptr<int[], Free> data_;
+    std::size_t capacity_ = 0;
+};
+
+// Number of times the product is halved before the classical kernel takes over:
+// recursion goes on while every dimension is larger than the cutoff
+int strassenDepth(int M, int K, int N, int cutoff);
+
+/*
+ * Computes C = A * B with the Strassen-Winograd scheme (7 products and 15 additions per
+ * level), switching to multiplyMatrices once the blocks are no larger than cutoff.
+ * Integer results are exact, the additions wrap modulo 2^32 like the classical kernel does.
+ */
+void multiplyStrassen(ConstMatrixView<int> A, ConstMatrixView<int> B, MatrixView<int> C, int cutoff,
+                      StrassenWorkspace& workspace);
+void multiplyStrassen(ConstMatrixView<int> A, ConstMatrixView<int> B, MatrixView<int> C, int cutoff);
+
+// Cutoff used by default: loaded once from the "strassen" entry of tileConfigPath() if present
+int strassenCutoff();
+void setStrassenCutoff(int cutoff);
+bool loadStrassenCutoff(const std::string& path, int& cutoff);
+// Appends the cutoff to a config file written by saveTileSizes
+bool saveStrassenCutoff(const std::string& path, int cutoff);
+
+// Times one recursion level against the classical kernel on growing square problems (up
+// to maxN) and returns the cutoff above which the recursion pays off
+int autotuneStrassenCutoff(int maxN = 2048);
+
+#endif // STRASSEN_H
@@ -0,0 +1,60 @@
+#ifndef STRUCTURE_H
+#define STRUCTURE_H
+
+#include "matrix.h"
+#include <vector>
+
+/*
+ * Shape of the nonzeros of a matrix, relative to a diagonal: element (i, j) lies on the
+ * diagonal when j == i + offset. The offset lets a block of rows [r, r + rows) of a
+ * square matrix (as held by a rank after scatterRows) be classified with offset r.
+ */
+enum class Structure { General, Zero, Identity, Diagonal, UpperTriangular, LowerTriangular };
+
+const char* structureName(Structure structure);
+
+// One pass over the matrix, stopping early once nonzeros on both sides of the diagonal are seen
+template <typename T>
+Structure detectStructure(ConstMatrixView<T> m, int diagonalOffset = 0);
+
+// Side of the square tiles the structured multiply works on and the zero-tile maps record
+constexpr int STRUCTURE_TILE = 64;
+
+// Products with a dimension below this skip the analysis: the pass over the inputs would cost
+// about as much as the product itself
+constexpr int STRUCTURE_MIN_DIM = 16;
+
+/*
+ * Which (STRUCTURE_TILE x STRUCTURE_TILE) tiles of a matrix are all zero. A tile with any
+ * nonzero stops its scan at that element, so the map of a dense matrix costs about one
+ * read per tile.
+ */
+struct ZeroTiles {
+    int rowTiles = 0;
+    int colTiles = 0;
+    int count = 0; // number of zero tiles
+    std::vector<char> zero;
+
+    bool operator()(int i, int j) const { return zero[static_cast<std::size_t>(i) * colTiles + j] != 0; }
+};
+
+template <typename T>
+ZeroTiles findZeroTiles(ConstMatrixView<T> m);
+
+/*
+ * Computes C = A * B like multiplyMatrices when A or B has a structure worth exploiting,
+ * and returns false without touching C otherwise (so the caller can run its usual kernel).
+ *  - a zero factor gives a zero C
+ *  - an identity factor is copied, a diagonal one scales the rows (A) or columns (B) of
+ *    the other factor
+ *  - otherwise, when either factor has all-zero tiles (triangular, block-diagonal or banded
+ *    inputs, or zero padding), the tiled product skips every (A tile, B tile) pair with a
+ *    zero side, which halves the work for a triangular factor
+ * diagonalOffset is the offset of A (see Structure); B is classified with offset 0.
+ * Skipped products are exact zeros, so floating-point Inf/NaN inputs in the other factor do
+ * not propagate through them.
+ */
+template <typename T, typename Acc>
+bool multiplyStructured(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C, int diagonalOffset = 0);
+
+#endif // STRUCTURE_H
@@ -0,0 +1,20 @@
+#ifndef SUMMA_H
+#define SUMMA_H
+
+#include "distribution.h"
+#include "matrix.h"
+
+/*
+ * Distributed C = A * B with SUMMA over a 2D process grid.
+ * A (M x K), B (K x N) and C (M x N) are all stored block-cyclically with the same
+ * block size; each rank passes only its local parts. For every block column k of A
+ * the owning grid column broadcasts its panel along grid rows, the owning grid row
+ * broadcasts the matching block row of B along grid columns, and every rank
+ * accumulates the panel product into its local C with multiplyAccumulate. Panels travel
+ * as T, so narrow element types also shrink the broadcasts; C accumulates in Acc.
+ */
+template <typename T, typename Acc>
+void summaMultiply(ConstMatrixView<T> localA, ConstMatrixView<T> localB, MatrixView<Acc> localC, int K,
+                   int blockSize, const ProcessGrid& grid);
+
+#endif // SUMMA_H
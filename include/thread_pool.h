@@ -0,0 +1,65 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Persistent pool of worker threads for the local multiply.
+ * parallelFor deals the task indices out in contiguous ranges, one per thread; a
+ * thread that runs out of work steals single tasks from the back of another
+ * thread's range. The calling thread takes part as thread 0, so only it ever
+ * makes MPI calls (MPI_THREAD_FUNNELED is enough).
+ */
+class ThreadPool {
+public:
+    // threads includes the caller; with pin, thread i is bound to the i-th CPU the process may use
+    ThreadPool(int threads, bool pin);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return static_cast<int>(ranges_.size()); }
+
+    // Runs task(i) for every i in [0, count) and returns once all of them are done. If a task
+    // throws, the tasks not started yet are dropped and the first exception is rethrown on the
+    // caller once every thread has stopped. Called from a task (nested), the loop runs serially
+    // on the calling thread.
+    void parallelFor(int count, const std::function<void(int)>& task);
+
+    // Pool used by multiplyMatrices: $MATMUL_THREADS threads (1 by default), pinned if
+    // $MATMUL_PIN is set, unless overridden with setThreads()
+    static ThreadPool& global();
+    static void setThreads(int threads, bool pin);
+
+private:
+    struct alignas(64) Range {
+        std::mutex mutex;
+        int begin = 0;
+        int end = 0;
+    };
+
+    void workerLoop(int id);
+    void runTasks(int id);
+    bool popOwn(int id, int& task);
+    bool steal(int id, int& task);
+
+    std::vector<Range> ranges_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(int)>* task_ = nullptr;
+    std::exception_ptr error_; // first exception of the current loop
+    std::uint64_t generation_ = 0;
+    int running_ = 0;
+    bool stop_ = false;
+};
+
+#endif // THREAD_POOL_H
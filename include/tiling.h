@@ -0,0 +1,34 @@
+#ifndef TILING_H
+#define TILING_H
+
+#include <string>
+
+/*
+ * Cache blocking parameters of the multiplication kernel.
+ *  - nc: columns per block, so that a row segment of B and one of C stay in L1
+ *  - kc: depth per block, so that the (kc x nc) block of B stays in L2
+ *  - mc: rows per block, so that the (mc x kc) block of A and (mc x nc) block of C stay in L3
+ */
+struct TileSizes {
+    int mc;
+    int kc;
+    int nc;
+};
+
+// Tile sizes derived from the cache sizes reported by the OS
+TileSizes defaultTileSizes();
+
+// Tile sizes used by multiplyMatrices: loaded once from tileConfigPath() if present,
+// otherwise defaultTileSizes()
+TileSizes tileSizes();
+void setTileSizes(const TileSizes& tiles);
+
+// Path of the tile config file ($MATMUL_TILE_CONFIG, or matmul_tiles.cfg in the working directory)
+std::string tileConfigPath();
+bool loadTileSizes(const std::string& path, TileSizes& tiles);
+bool saveTileSizes(const std::string& path, const TileSizes& tiles);
+
+// Times the blocked kernel on an (n x n) problem and returns the fastest tile sizes found
+TileSizes autotuneTileSizes(int n = 512);
+
+#endif // TILING_H
@@ -6,4 +6,4 @@
 
 module load openmpi
 export HWLOC_COMPONENTS=-gl
-mpirun -n 2 singularity exec --bind "$TMPDIR" matrix_multiplication.sif /main
\ No newline at end of file
+mpirun -n "$SLURM_NTASKS" singularity exec --bind "$TMPDIR" matrix_multiplication.sif /main
\ No newline at end of file
@@ -0,0 +1,54 @@
+#!/bin/bash
+# Strong and weak scaling of main under a local mpirun, on synthetic inputs.
+#
+#   strong: an N x N x N product on 1..R ranks
+#   weak:   (ROWS * ranks) x N times N x N on 1..R ranks, so every rank multiplies ROWS rows
+#
+# Every run appends one row to the CSV file (see `--csv` in the README): the slowest rank of
+# the read, distribute, compute, gather and write phases, the wall time and GOP/s.
+#
+# Usage: ./scaling.sh [-r MAX_RANKS] [-n N] [-w ROWS] [-k REPEATS] [-o FILE] [-- main options]
+# MPIRUN and MPIRUN_FLAGS pick the launcher, e.g. MPIRUN_FLAGS="--oversubscribe".
+
+set -e
+
+ranks=4
+size=2048
+rows=512
+repeats=3
+csv=scaling.csv
+while getopts "r:n:w:k:o:" opt; do
+    case $opt in
+    r) ranks=$OPTARG ;;
+    n) size=$OPTARG ;;
+    w) rows=$OPTARG ;;
+    k) repeats=$OPTARG ;;
+    o) csv=$OPTARG ;;
+    *) sed -n '2,13p' "$0"; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$1" = "--" ] && shift
+
+main=${MAIN:-$(dirname "$0")/build/main}
+output=$(mktemp -d)
+trap 'rm -rf "$output"' EXIT
+
+run() {
+    local label=$1 n=$2 m=$3
+    shift 3
+    for ((i = 0; i < repeats; i++)); do
+        ${MPIRUN:-mpirun} $MPIRUN_FLAGS -n "$n" "$main" --generate "$m" "$size" "$size" \
+            --output "$output/C.bin" --output-format binary --csv "$csv" --csv-label "$label" "$@" > /dev/null
+    done
+}
+
+for ((p = 1; p <= ranks; p++)); do
+    echo "strong scaling: $p ranks"
+    run strong "$p" "$size" "$@"
+done
+for ((p = 1; p <= ranks; p++)); do
+    echo "weak scaling: $p ranks"
+    run weak "$p" $((rows * p)) "$@"
+done
+echo "results in $csv"
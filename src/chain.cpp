@@ -0,0 +1,253 @@
+#include "chain.h"
+#include "matrix_multiplication.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// A partial product of the chain: either one of the factors or a buffer of the pool
+template <typename T>
+struct Partial {
+    MatrixView<const T> view;
+    bool pooled = false;
+};
+
+template <typename T>
+void releasePartial(MatrixPool<T>& pool, const Partial<T>& partial) {
+    if (partial.pooled) {
+        pool.release(partial.view.data());
+    }
+}
+
+// Product of factors i..j, written to target if it is given (the top of the chain) and to
+// a pool buffer otherwise
+template <typename T>
+Partial<T> evaluate(const std::vector<ConstMatrixView<T>>& factors, const ChainPlan& plan, int i, int j,
+                    MatrixPool<T>& pool, MatrixView<T>* target) {
+    if (i == j) {
+        return {factors[i], false};
+    }
+    const int s = plan.split(i, j);
+    const Partial<T> left = evaluate<T>(factors, plan, i, s, pool, nullptr);
+    const Partial<T> right = evaluate<T>(factors, plan, s + 1, j, pool, nullptr);
+    MatrixView<T> out = target != nullptr ? *target : pool.acquire(left.view.rows(), right.view.cols());
+    multiplyMatrices<T, T>(left.view, right.view, out);
+    releasePartial(pool, left);
+    releasePartial(pool, right);
+    return {out, target == nullptr};
+}
+
+// State shared by the steps of the distributed chain
+template <typename T>
+struct DistributedChain {
+    const std::vector<Matrix<T>>& factors; // root only
+    const ChainPlan& plan;
+    int root;
+    MPI_Comm comm;
+    int rank;
+    int size;
+    MatrixPool<T>& pool;
+
+    RowPartition rowsOf(int i) const { return RowPartition::balanced(plan.dims()[i], size); }
+
+    // This rank's rows of the product of factors i..j, written to target if it is given
+    Partial<T> localRows(int i, int j, MatrixView<T>* target) {
+        const RowPartition rows = rowsOf(i);
+        const int cols = plan.dims()[j + 1];
+        MatrixView<T> out = target != nullptr ? *target : pool.acquire(rows.counts[rank], cols);
+        if (i == j) {
+            PROFILE_SCOPE(Region::Scatter);
+            RowType<T> row(cols);
+            MPI_Scatterv(rank == root ? factors[i].data() : nullptr, rows.counts.data(), rows.offsets.data(), row,
+                         out.data(), out.rows(), row, root, comm);
+        } else {
+            const int s = plan.split(i, j);
+            const Partial<T> left = localRows(i, s, nullptr);
+            const Partial<T> right = everyRank(s + 1, j);
+            multiplyMatrices<T, T>(left.view, right.view, out);
+            releasePartial(pool, left);
+            releasePartial(pool, right);
+        }
+        return {out, target == nullptr};
+    }
+
+    // The whole product of factors i..j on every rank
+    Partial<T> everyRank(int i, int j) {
+        const int rows = plan.dims()[i];
+        const int cols = plan.dims()[j + 1];
+        RowType<T> row(cols);
+        if (i == j) {
+            PROFILE_SCOPE(Region::Broadcast);
+            // Root broadcasts the factor in place, the other ranks receive it in a pool buffer
+            if (rank == root) {
+                MPI_Bcast(const_cast<T*>(factors[i].data()), rows, row, root, comm);
+                return {factors[i], false};
+            }
+            MatrixView<T> full = pool.acquire(rows, cols);
+            MPI_Bcast(full.data(), rows, row, root, comm);
+            return {full, true};
+        }
+        const RowPartition partition = rowsOf(i);
+        const Partial<T> local = localRows(i, j, nullptr);
+        MatrixView<T> full = pool.acquire(rows, cols);
+        PROFILE_SCOPE(Region::Allgather);
+        MPI_Allgatherv(local.view.data(), local.view.rows(), row, full.data(), partition.counts.data(),
+                       partition.offsets.data(), row, comm);
+        releasePartial(pool, local);
+        return {full, true};
+    }
+};
+
+} // namespace
+
+ChainPlan::ChainPlan(std::vector<int> dims) : dims_(std::move(dims)) {
+    if (dims_.size() < 2 || std::any_of(dims_.begin(), dims_.end(), [](int d) { return d < 0; })) {
+        throw std::invalid_argument("ChainPlan: a chain needs at least one factor and non-negative dimensions");
+    }
+    const int n = factors();
+    std::vector<long long> cost(static_cast<std::size_t>(n) * n, 0);
+    split_.assign(static_cast<std::size_t>(n) * n, 0);
+    auto at = [n](int i, int j) { return static_cast<std::size_t>(i) * n + j; };
+
+    for (int length = 2; length <= n; ++length) {
+        for (int i = 0; i + length - 1 < n; ++i) {
+            const int j = i + length - 1;
+            long long best = std::numeric_limits<long long>::max();
+            for (int s = i; s < j; ++s) {
+                const long long c = cost[at(i, s)] + cost[at(s + 1, j)] +
+                                    static_cast<long long>(dims_[i]) * dims_[s + 1] * dims_[j + 1];
+                if (c < best) {
+                    best = c;
+                    split_[at(i, j)] = s;
+                }
+            }
+            cost[at(i, j)] = best;
+        }
+    }
+    cost_ = cost[at(0, n - 1)];
+}
+
+long long ChainPlan::leftToRightCost() const {
+    long long cost = 0;
+    for (int j = 1; j < factors(); ++j) {
+        cost += static_cast<long long>(dims_[0]) * dims_[j] * dims_[j + 1];
+    }
+    return cost;
+}
+
+std::string ChainPlan::toString() const {
+    return toString(0, factors() - 1);
+}
+
+std::string ChainPlan::toString(int i, int j) const {
+    if (i == j) {
+        return "A" + std::to_string(i);
+    }
+    const int s = split(i, j);
+    return "(" + toString(i, s) + " " + toString(s + 1, j) + ")";
+}
+
+template <typename T>
+MatrixView<T> MatrixPool<T>::acquire(int rows, int cols) {
+    const std::size_t need = static_cast<std::size_t>(rows) * cols;
+    if (need == 0) {
+        return MatrixView<T>(nullptr, rows, cols);
+    }
+    Buffer* best = nullptr;
+    for (Buffer& buffer : buffers_) {
+        if (!buffer.used && buffer.storage.size() >= need &&
+            (best == nullptr || buffer.storage.size() < best->storage.size())) {
+            best = &buffer;
+        }
+    }
+    if (best == nullptr) {
+        buffers_.push_back(Buffer{Matrix<T>(rows, cols), false});
+        best = &buffers_.back();
+    }
+    best->used = true;
+    return MatrixView<T>(best->storage.data(), rows, cols);
+}
+
+template <typename T>
+void MatrixPool<T>::release(const T* data) {
+    for (Buffer& buffer : buffers_) {
+        if (buffer.storage.data() == data) {
+            buffer.used = false;
+            return;
+        }
+    }
+}
+
+template <typename T>
+void multiplyChain(const std::vector<ConstMatrixView<T>>& factors, const ChainPlan& plan, MatrixView<T> C,
+                   MatrixPool<T>& pool) {
+    if (static_cast<int>(factors.size()) != plan.factors()) {
+        throw std::invalid_argument("multiplyChain: the plan is for a different number of factors");
+    }
+    for (int i = 0; i < plan.factors(); ++i) {
+        if (factors[i].rows() != plan.dims()[i] || factors[i].cols() != plan.dims()[i + 1]) {
+            throw std::invalid_argument("multiplyChain: factor " + std::to_string(i) + " does not match the plan");
+        }
+    }
+    if (C.rows() != plan.dims().front() || C.cols() != plan.dims().back()) {
+        throw std::invalid_argument("multiplyChain: incompatible result dimensions");
+    }
+
+    if (plan.factors() == 1) {
+        for (int i = 0; i < C.rows(); ++i) {
+            std::copy_n(factors[0].row(i), C.cols(), C.row(i));
+        }
+        return;
+    }
+    evaluate(factors, plan, 0, plan.factors() - 1, pool, &C);
+}
+
+template <typename T>
+Matrix<T> multiplyChain(const std::vector<ConstMatrixView<T>>& factors) {
+    std::vector<int> dims;
+    for (const ConstMatrixView<T>& factor : factors) {
+        if (!dims.empty() && dims.back() != factor.rows()) {
+            throw std::invalid_argument("multiplyChain: incompatible matrix dimensions");
+        }
+        if (dims.empty()) {
+            dims.push_back(factor.rows());
+        }
+        dims.push_back(factor.cols());
+    }
+    const ChainPlan plan(dims);
+    Matrix<T> C(dims.front(), dims.back());
+    MatrixPool<T> pool;
+    multiplyChain(factors, plan, C.view(), pool);
+    return C;
+}
+
+template <typename T>
+Matrix<T> multiplyChainAll(const std::vector<Matrix<T>>& factors, const ChainPlan& plan, int root, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    MatrixPool<T> pool;
+    DistributedChain<T> chain{factors, plan, root, comm, rank, size, pool};
+    Matrix<T> C(chain.rowsOf(0).counts[rank], plan.dims().back());
+    MatrixView<T> target = C.view();
+    chain.localRows(0, plan.factors() - 1, &target);
+    return C;
+}
+
+#define INSTANTIATE_CHAIN(T)                                                                                          \
+    template class MatrixPool<T>;                                                                                     \
+    template void multiplyChain<T>(const std::vector<ConstMatrixView<T>>&, const ChainPlan&, MatrixView<T>,           \
+                                   MatrixPool<T>&);                                                                   \
+    template Matrix<T> multiplyChain<T>(const std::vector<ConstMatrixView<T>>&);                                      \
+    template Matrix<T> multiplyChainAll<T>(const std::vector<Matrix<T>>&, const ChainPlan&, int, MPI_Comm);
+
+INSTANTIATE_CHAIN(std::int32_t)
+INSTANTIATE_CHAIN(std::int64_t)
+INSTANTIATE_CHAIN(float)
+INSTANTIATE_CHAIN(double)
+
+#undef INSTANTIATE_CHAIN
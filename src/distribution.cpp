@@ -0,0 +1,178 @@
+#include "distribution.h"
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <tuple>
+
+namespace {
+
+// Segments kept in flight by broadcastBytes
+constexpr int BCAST_WINDOW = 8;
+
+// Below this size the broadcast is latency bound and never segmented
+constexpr std::size_t BCAST_TUNE_THRESHOLD = 4 << 20;
+
+// Largest message actually sent while tuning
+constexpr std::size_t BCAST_TUNE_MAX_BYTES = 32 << 20;
+
+// Timed broadcasts per candidate segment size; the fastest one counts
+constexpr int BCAST_TUNE_REPEATS = 3;
+
+// Segment sizes measured so far, by (ranks, root, power of two of the tuned message size).
+// Every rank makes the same tuning calls in the same order, so the entries agree on all ranks.
+std::map<std::tuple<int, int, int>, std::size_t>& tunedSegments() {
+    static std::map<std::tuple<int, int, int>, std::size_t> segments;
+    return segments;
+}
+
+} // namespace
+
+RowPartition nonzeroPartition(const std::vector<int>& rowPtr, const RowPartition& rows) {
+    RowPartition p;
+    p.counts.resize(rows.counts.size());
+    p.offsets.resize(rows.offsets.size());
+    for (std::size_t r = 0; r < rows.counts.size(); ++r) {
+        p.offsets[r] = rowPtr[rows.offsets[r]];
+        p.counts[r] = rowPtr[rows.offsets[r] + rows.counts[r]] - p.offsets[r];
+    }
+    return p;
+}
+
+MPI_Datatype rowBlockType(int rows, int cols, const RowPartition& partition, int rank, MPI_Datatype element) {
+    if (partition.counts[rank] == 0 || cols == 0) {
+        return element;
+    }
+    int sizes[2] = {rows, cols};
+    int subsizes[2] = {partition.counts[rank], cols};
+    int starts[2] = {partition.offsets[rank], 0};
+    MPI_Datatype type;
+    MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, element, &type);
+    MPI_Type_commit(&type);
+    return type;
+}
+
+ProcessGrid ProcessGrid::create(MPI_Comm comm) {
+    int size;
+    MPI_Comm_size(comm, &size);
+
+    int dims[2] = {0, 0};
+    int periods[2] = {0, 0};
+    MPI_Dims_create(size, 2, dims);
+
+    ProcessGrid grid;
+    grid.rows = dims[0];
+    grid.cols = dims[1];
+    // No reordering: grid rank r is rank r of `comm`, laid out row-major
+    MPI_Cart_create(comm, 2, dims, periods, 0, &grid.comm);
+
+    int rank, coords[2];
+    MPI_Comm_rank(grid.comm, &rank);
+    MPI_Cart_coords(grid.comm, rank, 2, coords);
+    grid.myRow = coords[0];
+    grid.myCol = coords[1];
+
+    int keepCols[2] = {0, 1};
+    int keepRows[2] = {1, 0};
+    MPI_Cart_sub(grid.comm, keepCols, &grid.rowComm);
+    MPI_Cart_sub(grid.comm, keepRows, &grid.colComm);
+    return grid;
+}
+
+void ProcessGrid::free() {
+    MPI_Comm_free(&rowComm);
+    MPI_Comm_free(&colComm);
+    MPI_Comm_free(&comm);
+}
+
+int BlockCyclicLayout::localCount(int n, int nb, int p, int nprocs) {
+    const int blocks = n / nb;
+    int count = (blocks / nprocs) * nb;
+    const int extra = blocks % nprocs;
+    if (p < extra) {
+        count += nb;
+    } else if (p == extra) {
+        count += n % nb;
+    }
+    return count;
+}
+
+MPI_Datatype blockCyclicType(const BlockCyclicLayout& layout, const ProcessGrid& grid, int gridRank, MPI_Datatype element) {
+    int gsizes[2] = {layout.rows, layout.cols};
+    int distribs[2] = {MPI_DISTRIBUTE_CYCLIC, MPI_DISTRIBUTE_CYCLIC};
+    int dargs[2] = {layout.blockSize, layout.blockSize};
+    int psizes[2] = {grid.rows, grid.cols};
+
+    MPI_Datatype type;
+    MPI_Type_create_darray(grid.rows * grid.cols, gridRank, 2, gsizes, distribs, dargs, psizes, MPI_ORDER_C, element,
+                           &type);
+    MPI_Type_commit(&type);
+    return type;
+}
+
+void broadcastBytes(void* data, std::size_t bytes, std::size_t segment, int root, MPI_Comm comm) {
+    PROFILE_SCOPE(Region::Broadcast);
+    if (segment == BCAST_SINGLE_MESSAGE || segment > INT_MAX) {
+        segment = INT_MAX;
+    }
+
+    char* p = static_cast<char*>(data);
+    std::vector<MPI_Request> window;
+    for (std::size_t offset = 0; offset < bytes; offset += segment) {
+        if (window.size() == BCAST_WINDOW) {
+            MPI_Waitall(static_cast<int>(window.size()), window.data(), MPI_STATUSES_IGNORE);
+            window.clear();
+        }
+        const int count = static_cast<int>(std::min(segment, bytes - offset));
+        window.emplace_back();
+        MPI_Ibcast(p + offset, count, MPI_BYTE, root, comm, &window.back());
+    }
+    MPI_Waitall(static_cast<int>(window.size()), window.data(), MPI_STATUSES_IGNORE);
+}
+
+std::size_t tuneBroadcastSegment(std::size_t bytes, int root, MPI_Comm comm) {
+    int size;
+    MPI_Comm_size(comm, &size);
+    if (size == 1 || bytes < BCAST_TUNE_THRESHOLD) {
+        return BCAST_SINGLE_MESSAGE;
+    }
+
+    const std::size_t tuned = std::min(bytes, BCAST_TUNE_MAX_BYTES);
+    int bucket = 0;
+    while ((tuned >> (bucket + 1)) != 0) {
+        ++bucket;
+    }
+    const auto key = std::make_tuple(size, root, bucket);
+    const auto known = tunedSegments().find(key);
+    if (known != tunedSegments().end()) {
+        return known->second;
+    }
+
+    std::vector<char> buffer(tuned);
+    const std::size_t candidates[] = {BCAST_SINGLE_MESSAGE, 64 << 10, 256 << 10, 1 << 20, 4 << 20};
+
+    // One untimed broadcast first, so connection setup is not charged to the first candidate
+    broadcastBytes(buffer.data(), buffer.size(), BCAST_SINGLE_MESSAGE, root, comm);
+    std::size_t best = BCAST_SINGLE_MESSAGE;
+    double bestTime = 0.0;
+    for (std::size_t segment : candidates) {
+        if (segment >= buffer.size()) {
+            continue;
+        }
+        double fastest = 0.0;
+        for (int repeat = 0; repeat < BCAST_TUNE_REPEATS; ++repeat) {
+            MPI_Barrier(comm);
+            const double start = MPI_Wtime();
+            broadcastBytes(buffer.data(), buffer.size(), segment, root, comm);
+            const double elapsed = MPI_Wtime() - start;
+            fastest = repeat == 0 ? elapsed : std::min(fastest, elapsed);
+        }
+        // A broadcast is as slow as its slowest receiver
+        MPI_Allreduce(MPI_IN_PLACE, &fastest, 1, MPI_DOUBLE, MPI_MAX, comm);
+        if (segment == BCAST_SINGLE_MESSAGE || fastest < bestTime) {
+            best = segment;
+            bestTime = fastest;
+        }
+    }
+    tunedSegments()[key] = best;
+    return best;
+}
@@ -0,0 +1,562 @@
+#include "kernels.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MATMUL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+Isa initialIsa() {
+    Isa isa = detectIsa();
+    const char* requested = std::getenv("MATMUL_ISA");
+    if (requested != nullptr) {
+        for (Isa candidate : {Isa::Scalar, Isa::Avx2, Isa::Avx512}) {
+            if (std::strcmp(requested, isaName(candidate)) == 0 && isaSupported(candidate)) {
+                isa = candidate;
+            }
+        }
+    }
+    return isa;
+}
+
+Isa& currentIsa() {
+    static Isa isa = initialIsa();
+    return isa;
+}
+
+// C[rows, cols] += A * B for the given row and column range, one element at a time
+void scalarRange(const int* A, std::ptrdiff_t lda, const int* B, std::ptrdiff_t ldb, int* C, std::ptrdiff_t ldc,
+                 int rowBegin, int rowEnd, int colBegin, int colEnd, int kb) {
+    for (int i = rowBegin; i < rowEnd; ++i) {
+        const int* a = A + i * lda;
+        int* c = C + i * ldc;
+        for (int k = 0; k < kb; ++k) {
+            const int aik = a[k];
+            const int* b = B + k * ldb;
+            for (int j = colBegin; j < colEnd; ++j) {
+                c[j] += aik * b[j];
+            }
+        }
+    }
+}
+
+// Vector type of the typed kernels (GCC vector extension): one 64-byte vector of Acc,
+// filled from the W elements of T that widen into it
+template <typename T, typename Acc>
+struct Lanes {
+    static constexpr int W = 64 / sizeof(Acc);
+    typedef Acc Vec __attribute__((vector_size(64)));
+
+    // Widening load of W elements of T (vpmovsx* / vcvtps2pd on x86)
+    __attribute__((always_inline)) static void load(Vec& v, const T* p) {
+        if constexpr (std::is_same_v<T, Acc>) {
+            std::memcpy(&v, p, sizeof(v));
+        } else {
+            for (int w = 0; w < W; ++w) {
+                v[w] = p[w];
+            }
+        }
+    }
+    __attribute__((always_inline)) static void loadAcc(Vec& v, const Acc* p) { std::memcpy(&v, p, sizeof(v)); }
+    __attribute__((always_inline)) static void store(Acc* p, const Vec& v) { std::memcpy(p, &v, sizeof(v)); }
+};
+
+/*
+ * Portable body of the typed kernels, with the same register tiling as the int kernels:
+ * 4 rows x 2 vectors of C stay in accumulators while one element of A per row, widened to
+ * Acc, is multiplied against 2 widened vectors of B. The per-ISA wrappers below inline
+ * it, so the vector code is generated for the 64-byte, 32-byte or 16-byte registers of
+ * that ISA.
+ */
+template <typename T, typename Acc>
+__attribute__((always_inline)) inline void typedKernelBody(const T* A, std::ptrdiff_t lda, const T* B,
+                                                           std::ptrdiff_t ldb, Acc* C, std::ptrdiff_t ldc, int mb,
+                                                           int nb, int kb) {
+    using L = Lanes<T, Acc>;
+    using Vec = typename L::Vec;
+    constexpr int W = L::W;
+
+    int i = 0;
+    for (; i + 4 <= mb; i += 4) {
+        int j = 0;
+        for (; j + 2 * W <= nb; j += 2 * W) {
+            Vec acc[4][2];
+            for (int r = 0; r < 4; ++r) {
+                L::loadAcc(acc[r][0], C + (i + r) * ldc + j);
+                L::loadAcc(acc[r][1], C + (i + r) * ldc + j + W);
+            }
+            for (int k = 0; k < kb; ++k) {
+                Vec b0, b1;
+                L::load(b0, B + k * ldb + j);
+                L::load(b1, B + k * ldb + j + W);
+                for (int r = 0; r < 4; ++r) {
+                    const Acc a = A[(i + r) * lda + k];
+                    acc[r][0] += a * b0;
+                    acc[r][1] += a * b1;
+                }
+            }
+            for (int r = 0; r < 4; ++r) {
+                L::store(C + (i + r) * ldc + j, acc[r][0]);
+                L::store(C + (i + r) * ldc + j + W, acc[r][1]);
+            }
+        }
+        for (int r = i; r < i + 4; ++r) {
+            for (int k = 0; k < kb; ++k) {
+                const Acc a = A[r * lda + k];
+                for (int jj = j; jj < nb; ++jj) {
+                    C[r * ldc + jj] += a * static_cast<Acc>(B[k * ldb + jj]);
+                }
+            }
+        }
+    }
+    for (; i < mb; ++i) {
+        int j = 0;
+        for (; j + W <= nb; j += W) {
+            Vec acc, b;
+            L::loadAcc(acc, C + i * ldc + j);
+            for (int k = 0; k < kb; ++k) {
+                L::load(b, B + k * ldb + j);
+                acc += static_cast<Acc>(A[i * lda + k]) * b;
+            }
+            L::store(C + i * ldc + j, acc);
+        }
+        for (int k = 0; k < kb; ++k) {
+            const Acc a = A[i * lda + k];
+            for (int jj = j; jj < nb; ++jj) {
+                C[i * ldc + jj] += a * static_cast<Acc>(B[k * ldb + jj]);
+            }
+        }
+    }
+}
+
+template <typename T, typename Acc>
+void typedKernelScalar(const T* A, std::ptrdiff_t lda, const T* B, std::ptrdiff_t ldb, Acc* C, std::ptrdiff_t ldc,
+                       int mb, int nb, int kb) {
+    typedKernelBody(A, lda, B, ldb, C, ldc, mb, nb, kb);
+}
+
+#ifdef MATMUL_X86
+
+template <typename T, typename Acc>
+__attribute__((target("avx2,fma")))
+void typedKernelAvx2(const T* A, std::ptrdiff_t lda, const T* B, std::ptrdiff_t ldb, Acc* C, std::ptrdiff_t ldc,
+                     int mb, int nb, int kb) {
+    typedKernelBody(A, lda, B, ldb, C, ldc, mb, nb, kb);
+}
+
+template <typename T, typename Acc>
+__attribute__((target("avx512f,avx512bw,avx512dq")))
+void typedKernelAvx512(const T* A, std::ptrdiff_t lda, const T* B, std::ptrdiff_t ldb, Acc* C, std::ptrdiff_t ldc,
+                       int mb, int nb, int kb) {
+    typedKernelBody(A, lda, B, ldb, C, ldc, mb, nb, kb);
+}
+
+#else
+
+template <typename T, typename Acc>
+void typedKernelAvx2(const T* A, std::ptrdiff_t lda, const T* B, std::ptrdiff_t ldb, Acc* C, std::ptrdiff_t ldc,
+                     int mb, int nb, int kb) {
+    typedKernelBody(A, lda, B, ldb, C, ldc, mb, nb, kb);
+}
+
+template <typename T, typename Acc>
+void typedKernelAvx512(const T* A, std::ptrdiff_t lda, const T* B, std::ptrdiff_t ldb, Acc* C, std::ptrdiff_t ldc,
+                       int mb, int nb, int kb) {
+    typedKernelBody(A, lda, B, ldb, C, ldc, mb, nb, kb);
+}
+
+#endif
+
+// Portable body of the GEMV kernels: 4 rows of A at a time, each with a vector of partial
+// sums, reduced once at the end of the row
+template <typename T, typename Acc>
+__attribute__((always_inline)) inline void gemvBody(const T* A, std::ptrdiff_t lda, const Acc* x, Acc* y,
+                                                    std::ptrdiff_t incy, int m, int k) {
+    using L = Lanes<T, Acc>;
+    using Vec = typename L::Vec;
+    constexpr int W = L::W;
+
+    auto reduce = [](const Vec& v) {
+        Acc sum = Acc();
+        for (int w = 0; w < W; ++w) {
+            sum += v[w];
+        }
+        return sum;
+    };
+
+    int i = 0;
+    for (; i + 4 <= m; i += 4) {
+        Vec acc[4] = {};
+        int j = 0;
+        for (; j + W <= k; j += W) {
+            Vec xv, a;
+            L::loadAcc(xv, x + j);
+            for (int r = 0; r < 4; ++r) {
+                L::load(a, A + (i + r) * lda + j);
+                acc[r] += a * xv;
+            }
+        }
+        for (int r = 0; r < 4; ++r) {
+            Acc sum = reduce(acc[r]);
+            for (int jj = j; jj < k; ++jj) {
+                sum += static_cast<Acc>(A[(i + r) * lda + jj]) * x[jj];
+            }
+            y[(i + r) * incy] += sum;
+        }
+    }
+    for (; i < m; ++i) {
+        Vec acc = {};
+        int j = 0;
+        for (; j + W <= k; j += W) {
+            Vec xv, a;
+            L::loadAcc(xv, x + j);
+            L::load(a, A + i * lda + j);
+            acc += a * xv;
+        }
+        Acc sum = reduce(acc);
+        for (; j < k; ++j) {
+            sum += static_cast<Acc>(A[i * lda + j]) * x[j];
+        }
+        y[i * incy] += sum;
+    }
+}
+
+// y = alpha * x when overwrite is set, y += alpha * x otherwise; overwriting never reads y,
+// so a freshly allocated C is only written once
+template <typename T, typename Acc>
+__attribute__((always_inline)) inline void axpyBody(Acc alpha, const T* x, Acc* y, int n, bool overwrite) {
+    using L = Lanes<T, Acc>;
+    using Vec = typename L::Vec;
+    constexpr int W = L::W;
+
+    int j = 0;
+    if (overwrite) {
+        for (; j + 2 * W <= n; j += 2 * W) {
+            Vec x0, x1;
+            L::load(x0, x + j);
+            L::load(x1, x + j + W);
+            L::store(y + j, alpha * x0);
+            L::store(y + j + W, alpha * x1);
+        }
+        for (; j < n; ++j) {
+            y[j] = alpha * static_cast<Acc>(x[j]);
+        }
+        return;
+    }
+    for (; j + 2 * W <= n; j += 2 * W) {
+        Vec x0, x1, y0, y1;
+        L::load(x0, x + j);
+        L::load(x1, x + j + W);
+        L::loadAcc(y0, y + j);
+        L::loadAcc(y1, y + j + W);
+        y0 += alpha * x0;
+        y1 += alpha * x1;
+        L::store(y + j, y0);
+        L::store(y + j + W, y1);
+    }
+    for (; j < n; ++j) {
+        y[j] += alpha * static_cast<Acc>(x[j]);
+    }
+}
+
+// Per-ISA wrappers of a kernel body, like the typed block kernels. The target features
+// are the ones detectIsa() checks before selecting the level
+#ifdef MATMUL_X86
+#define MATMUL_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define MATMUL_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512dq")))
+#else
+#define MATMUL_TARGET_AVX2
+#define MATMUL_TARGET_AVX512
+#endif
+
+template <typename T, typename Acc>
+void gemvScalar(const T* A, std::ptrdiff_t lda, const Acc* x, Acc* y, std::ptrdiff_t incy, int m, int k) {
+    gemvBody(A, lda, x, y, incy, m, k);
+}
+template <typename T, typename Acc>
+MATMUL_TARGET_AVX2 void gemvAvx2(const T* A, std::ptrdiff_t lda, const Acc* x, Acc* y, std::ptrdiff_t incy, int m,
+                                 int k) {
+    gemvBody(A, lda, x, y, incy, m, k);
+}
+template <typename T, typename Acc>
+MATMUL_TARGET_AVX512 void gemvAvx512(const T* A, std::ptrdiff_t lda, const Acc* x, Acc* y, std::ptrdiff_t incy,
+                                     int m, int k) {
+    gemvBody(A, lda, x, y, incy, m, k);
+}
+
+template <typename T, typename Acc>
+void axpyScalar(Acc alpha, const T* x, Acc* y, int n, bool overwrite) {
+    axpyBody(alpha, x, y, n, overwrite);
+}
+template <typename T, typename Acc>
+MATMUL_TARGET_AVX2 void axpyAvx2(Acc alpha, const T* x, Acc* y, int n, bool overwrite) {
+    axpyBody(alpha, x, y, n, overwrite);
+}
+template <typename T, typename Acc>
+MATMUL_TARGET_AVX512 void axpyAvx512(Acc alpha, const T* x, Acc* y, int n, bool overwrite) {
+    axpyBody(alpha, x, y, n, overwrite);
+}
+
+#undef MATMUL_TARGET_AVX2
+#undef MATMUL_TARGET_AVX512
+
+} // namespace
+
+const char* isaName(Isa isa) {
+    switch (isa) {
+    case Isa::Avx2:
+        return "avx2";
+    case Isa::Avx512:
+        return "avx512";
+    default:
+        return "scalar";
+    }
+}
+
+// Every feature a kernel of the level is compiled for must be checked here: a node with
+// AVX-512F but no BW/DQ (Knights Landing) or AVX2 without FMA falls back a level
+Isa detectIsa() {
+#ifdef MATMUL_X86
+    __builtin_cpu_init();
+    const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (avx2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512dq")) {
+        return Isa::Avx512;
+    }
+    if (avx2) {
+        return Isa::Avx2;
+    }
+#endif
+    return Isa::Scalar;
+}
+
+bool isaSupported(Isa isa) {
+    return static_cast<int>(isa) <= static_cast<int>(detectIsa());
+}
+
+Isa activeIsa() {
+    return currentIsa();
+}
+
+bool setIsa(Isa isa) {
+    if (!isaSupported(isa)) {
+        return false;
+    }
+    currentIsa() = isa;
+    return true;
+}
+
+BlockKernel blockKernel(Isa isa) {
+    switch (isa) {
+    case Isa::Avx2:
+        return blockKernelAvx2;
+    case Isa::Avx512:
+        return blockKernelAvx512;
+    default:
+        return blockKernelScalar;
+    }
+}
+
+template <typename T, typename Acc>
+BlockKernelOf<T, Acc> blockKernelFor(Isa isa) {
+    if constexpr (std::is_same_v<T, int> && std::is_same_v<Acc, int>) {
+        return blockKernel(isa);
+    } else {
+        switch (isa) {
+        case Isa::Avx2:
+            return typedKernelAvx2<T, Acc>;
+        case Isa::Avx512:
+            return typedKernelAvx512<T, Acc>;
+        default:
+            return typedKernelScalar<T, Acc>;
+        }
+    }
+}
+
+template <typename T, typename Acc>
+GemvKernelOf<T, Acc> gemvKernelFor(Isa isa) {
+    switch (isa) {
+    case Isa::Avx2:
+        return gemvAvx2<T, Acc>;
+    case Isa::Avx512:
+        return gemvAvx512<T, Acc>;
+    default:
+        return gemvScalar<T, Acc>;
+    }
+}
+
+template <typename T, typename Acc>
+AxpyKernelOf<T, Acc> axpyKernelFor(Isa isa) {
+    switch (isa) {
+    case Isa::Avx2:
+        return axpyAvx2<T, Acc>;
+    case Isa::Avx512:
+        return axpyAvx512<T, Acc>;
+    default:
+        return axpyScalar<T, Acc>;
+    }
+}
+
+// The (element, accumulator) pairs listed in matrix_multiplication.h
+#define INSTANTIATE_KERNELS(T, Acc)                                                                                   \
+    template BlockKernelOf<T, Acc> blockKernelFor<T, Acc>(Isa);                                                       \
+    template GemvKernelOf<T, Acc> gemvKernelFor<T, Acc>(Isa);                                                         \
+    template AxpyKernelOf<T, Acc> axpyKernelFor<T, Acc>(Isa);
+
+INSTANTIATE_KERNELS(std::int8_t, std::int32_t)
+INSTANTIATE_KERNELS(std::int8_t, std::int64_t)
+INSTANTIATE_KERNELS(std::int16_t, std::int32_t)
+INSTANTIATE_KERNELS(std::int16_t, std::int64_t)
+INSTANTIATE_KERNELS(std::int32_t, std::int32_t)
+INSTANTIATE_KERNELS(std::int32_t, std::int64_t)
+INSTANTIATE_KERNELS(std::int64_t, std::int64_t)
+INSTANTIATE_KERNELS(float, float)
+INSTANTIATE_KERNELS(float, double)
+INSTANTIATE_KERNELS(double, double)
+
+#undef INSTANTIATE_KERNELS
+
+void blockKernelScalar(const int* A, std::ptrdiff_t lda, const int* B, std::ptrdiff_t ldb, int* C,
+                       std::ptrdiff_t ldc, int mb, int nb, int kb) {
+    scalarRange(A, lda, B, ldb, C, ldc, 0, mb, 0, nb, kb);
+}
+
+#ifdef MATMUL_X86
+
+__attribute__((target("avx2")))
+void blockKernelAvx2(const int* A, std::ptrdiff_t lda, const int* B, std::ptrdiff_t ldb, int* C,
+                     std::ptrdiff_t ldc, int mb, int nb, int kb) {
+    int i = 0;
+    for (; i + 4 <= mb; i += 4) {
+        int j = 0;
+        // 4 x 16 register tile: 8 accumulators, 2 vectors of B and 1 broadcast per k
+        for (; j + 16 <= nb; j += 16) {
+            __m256i acc[4][2];
+            for (int r = 0; r < 4; ++r) {
+                acc[r][0] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(C + (i + r) * ldc + j));
+                acc[r][1] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(C + (i + r) * ldc + j + 8));
+            }
+            for (int k = 0; k < kb; ++k) {
+                const int* b = B + k * ldb + j;
+                __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+                __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + 8));
+                for (int r = 0; r < 4; ++r) {
+                    __m256i a = _mm256_set1_epi32(A[(i + r) * lda + k]);
+                    acc[r][0] = _mm256_add_epi32(acc[r][0], _mm256_mullo_epi32(a, b0));
+                    acc[r][1] = _mm256_add_epi32(acc[r][1], _mm256_mullo_epi32(a, b1));
+                }
+            }
+            for (int r = 0; r < 4; ++r) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(C + (i + r) * ldc + j), acc[r][0]);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(C + (i + r) * ldc + j + 8), acc[r][1]);
+            }
+        }
+        for (; j + 8 <= nb; j += 8) {
+            __m256i acc[4];
+            for (int r = 0; r < 4; ++r) {
+                acc[r] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(C + (i + r) * ldc + j));
+            }
+            for (int k = 0; k < kb; ++k) {
+                __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(B + k * ldb + j));
+                for (int r = 0; r < 4; ++r) {
+                    acc[r] = _mm256_add_epi32(acc[r], _mm256_mullo_epi32(_mm256_set1_epi32(A[(i + r) * lda + k]), b0));
+                }
+            }
+            for (int r = 0; r < 4; ++r) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(C + (i + r) * ldc + j), acc[r]);
+            }
+        }
+        scalarRange(A, lda, B, ldb, C, ldc, i, i + 4, j, nb, kb);
+    }
+    for (; i < mb; ++i) {
+        int j = 0;
+        for (; j + 8 <= nb; j += 8) {
+            __m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(C + i * ldc + j));
+            for (int k = 0; k < kb; ++k) {
+                __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(B + k * ldb + j));
+                acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(_mm256_set1_epi32(A[i * lda + k]), b0));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(C + i * ldc + j), acc);
+        }
+        scalarRange(A, lda, B, ldb, C, ldc, i, i + 1, j, nb, kb);
+    }
+}
+
+__attribute__((target("avx512f")))
+void blockKernelAvx512(const int* A, std::ptrdiff_t lda, const int* B, std::ptrdiff_t ldb, int* C,
+                       std::ptrdiff_t ldc, int mb, int nb, int kb) {
+    int i = 0;
+    for (; i + 4 <= mb; i += 4) {
+        int j = 0;
+        // 4 x 32 register tile: 8 accumulators, 2 vectors of B and 1 broadcast per k
+        for (; j + 32 <= nb; j += 32) {
+            __m512i acc[4][2];
+            for (int r = 0; r < 4; ++r) {
+                acc[r][0] = _mm512_loadu_si512(C + (i + r) * ldc + j);
+                acc[r][1] = _mm512_loadu_si512(C + (i + r) * ldc + j + 16);
+            }
+            for (int k = 0; k < kb; ++k) {
+                const int* b = B + k * ldb + j;
+                __m512i b0 = _mm512_loadu_si512(b);
+                __m512i b1 = _mm512_loadu_si512(b + 16);
+                for (int r = 0; r < 4; ++r) {
+                    __m512i a = _mm512_set1_epi32(A[(i + r) * lda + k]);
+                    acc[r][0] = _mm512_add_epi32(acc[r][0], _mm512_mullo_epi32(a, b0));
+                    acc[r][1] = _mm512_add_epi32(acc[r][1], _mm512_mullo_epi32(a, b1));
+                }
+            }
+            for (int r = 0; r < 4; ++r) {
+                _mm512_storeu_si512(C + (i + r) * ldc + j, acc[r][0]);
+                _mm512_storeu_si512(C + (i + r) * ldc + j + 16, acc[r][1]);
+            }
+        }
+        // Remaining columns, 16 at a time with a mask on the last vector
+        for (; j < nb; j += 16) {
+            const __mmask16 mask = nb - j >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (nb - j)) - 1);
+            __m512i acc[4];
+            for (int r = 0; r < 4; ++r) {
+                acc[r] = _mm512_maskz_loadu_epi32(mask, C + (i + r) * ldc + j);
+            }
+            for (int k = 0; k < kb; ++k) {
+                __m512i b0 = _mm512_maskz_loadu_epi32(mask, B + k * ldb + j);
+                for (int r = 0; r < 4; ++r) {
+                    acc[r] = _mm512_add_epi32(acc[r], _mm512_mullo_epi32(_mm512_set1_epi32(A[(i + r) * lda + k]), b0));
+                }
+            }
+            for (int r = 0; r < 4; ++r) {
+                _mm512_mask_storeu_epi32(C + (i + r) * ldc + j, mask, acc[r]);
+            }
+        }
+    }
+    for (; i < mb; ++i) {
+        for (int j = 0; j < nb; j += 16) {
+            const __mmask16 mask = nb - j >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (nb - j)) - 1);
+            __m512i acc = _mm512_maskz_loadu_epi32(mask, C + i * ldc + j);
+            for (int k = 0; k < kb; ++k) {
+                __m512i b0 = _mm512_maskz_loadu_epi32(mask, B + k * ldb + j);
+                acc = _mm512_add_epi32(acc, _mm512_mullo_epi32(_mm512_set1_epi32(A[i * lda + k]), b0));
+            }
+            _mm512_mask_storeu_epi32(C + i * ldc + j, mask, acc);
+        }
+    }
+}
+
+#else
+
+void blockKernelAvx2(const int* A, std::ptrdiff_t lda, const int* B, std::ptrdiff_t ldb, int* C,
+                     std::ptrdiff_t ldc, int mb, int nb, int kb) {
+    blockKernelScalar(A, lda, B, ldb, C, ldc, mb, nb, kb);
+}
+
+void blockKernelAvx512(const int* A, std::ptrdiff_t lda, const int* B, std::ptrdiff_t ldb, int* C,
+                       std::ptrdiff_t ldc, int mb, int nb, int kb) {
+    blockKernelScalar(A, lda, B, ldb, C, ldc, mb, nb, kb);
+}
+
+#endif
@@ -1,84 +1,1197 @@
+#include "chain.h"
+#include "distribution.h"
+#include "matrix_io.h"
 #include "matrix_multiplication.h"
+#include "parallel_io.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "service.h"
+#include "sparse.h"
+#include "strassen.h"
+#include "structure.h"
+#include "summa.h"
+#include "thread_pool.h"
 #include <mpi.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
-#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unistd.h>
 #include <vector>
 
-void readMatrixFromFile(const std::string& filename, std::vector<std::vector<int>>& matrix, int& rows, int& cols) {
-    std::ifstream infile(filename);
-    if (!infile) {
-        std::cerr << "Error opening file: " << filename << std::endl;
-        MPI_Abort(MPI_COMM_WORLD, 1);
+enum class OutputFormat { Text, Binary, MpiIo };
+
+// When text inputs go through the sparse kernels: below the density threshold, always or never
+enum class SparseMode { Auto, Always, Never };
+
+// Where C goes: stdout when path is empty, otherwise a file in the given format
+struct Output {
+    std::string path;
+    OutputFormat format = OutputFormat::Text;
+};
+
+struct Options {
+    bool autotune = false;
+    bool timing = false;
+    bool summa = false;
+    int strassen = 0; // Strassen-Winograd cutoff for the local multiply, 0 = classical kernel
+    bool structure = true; // zero, identity, diagonal and zero-tile inputs take the structured kernels
+    SparseMode sparse = SparseMode::Auto;
+    double sparseThreshold = SPARSE_DENSITY_THRESHOLD;
+    int blockSize = 256;
+    long long bcastSegment = -1; // bytes per broadcast segment, 0 = single message, -1 = measured
+    bool pipeline = false; // --pipeline: overlap the broadcast of B and the gather of C with the compute
+    int panelWidth = 0; // columns of B per pipeline panel, 0 = pipelinePanelWidth()
+    std::string pathA = "matrixA.txt";
+    std::string pathB = "matrixB.txt";
+    std::vector<std::string> chain; // --chain: factors of a chain product, instead of A and B
+    std::vector<int> generate; // --generate M K N: synthetic M x K and K x N inputs instead of files
+    unsigned seed = 1;
+    std::string csv; // --csv: file the timing row of the job is appended to
+    std::string csvLabel;
+    bool profile = false; // --profile: one-line summary of the profiled regions
+    std::string profileJson; // --profile-json: file the summary is written to as JSON
+    bool profileCounters = false; // read the hardware counters in the profiled regions
+    std::string trace; // --trace: Chrome trace file of the job, merged on rank 0
+    std::string serve; // --serve: socket of the service mode, empty for a single job
+    std::size_t cacheBytes = std::size_t(1024) << 20; // per-rank budget of the service's cache of B
+    bool verify = false;
+    int readThreads = 1;
+    std::string accumulate; // accumulator type name, empty = default for the input type
+    int threads = 0; // 0 = $MATMUL_THREADS
+    bool pin = false;
+    Output output;
+};
+
+// What a rank did during the distributed multiply, for the timing report: seconds spent
+// reading (or generating) the inputs, distributing them, computing, gathering C and writing it
+struct RunStats {
+    int localRows = 0;
+    double read = 0.0;
+    double distribute = 0.0;
+    double compute = 0.0;
+    double gather = 0.0;
+    double output = 0.0;
+    // The product that ran, for the CSV rows: C is rows x cols, inner is 0 for a chain
+    int rows = 0;
+    int inner = 0;
+    int cols = 0;
+    double operations = 0.0;
+};
+
+bool parseOptions(int argc, char** argv, Options& options, std::ostream& errors) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--autotune") {
+            options.autotune = true;
+        } else if (arg == "--timing") {
+            options.timing = true;
+        } else if (arg == "--a" && i + 1 < argc) {
+            options.pathA = argv[++i];
+        } else if (arg == "--b" && i + 1 < argc) {
+            options.pathB = argv[++i];
+        } else if (arg == "--chain") {
+            while (i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0) {
+                options.chain.push_back(argv[++i]);
+            }
+            if (options.chain.size() < 2) {
+                errors << "--chain needs at least two matrix files" << std::endl;
+                return false;
+            }
+        } else if (arg == "--generate" && i + 3 < argc) {
+            options.generate = {std::atoi(argv[i + 1]), std::atoi(argv[i + 2]), std::atoi(argv[i + 3])};
+            i += 3;
+            if (*std::min_element(options.generate.begin(), options.generate.end()) <= 0) {
+                errors << "Invalid generated dimensions" << std::endl;
+                return false;
+            }
+        } else if (arg == "--seed" && i + 1 < argc) {
+            options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--csv" && i + 1 < argc) {
+            options.csv = argv[++i];
+        } else if (arg == "--csv-label" && i + 1 < argc) {
+            options.csvLabel = argv[++i];
+        } else if (arg == "--profile") {
+            options.profile = true;
+        } else if (arg == "--profile-json" && i + 1 < argc) {
+            options.profileJson = argv[++i];
+        } else if (arg == "--profile-counters") {
+            options.profile = true;
+            options.profileCounters = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            options.trace = argv[++i];
+        } else if (arg == "--serve" && i + 1 < argc) {
+            options.serve = argv[++i];
+        } else if (arg == "--cache-mb" && i + 1 < argc) {
+            const long long megabytes = std::atoll(argv[++i]);
+            if (megabytes < 0) {
+                errors << "Invalid cache size: " << argv[i] << std::endl;
+                return false;
+            }
+            options.cacheBytes = static_cast<std::size_t>(megabytes) << 20;
+        } else if (arg == "--verify") {
+            options.verify = true;
+        } else if (arg == "--read-threads" && i + 1 < argc) {
+            options.readThreads = std::atoi(argv[++i]);
+            if (options.readThreads <= 0) {
+                errors << "Invalid number of read threads: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--accumulate" && i + 1 < argc) {
+            options.accumulate = argv[++i];
+            DType dtype;
+            if (!parseDType(options.accumulate, dtype)) {
+                errors << "Unknown accumulator type: " << options.accumulate << std::endl;
+                return false;
+            }
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::atoi(argv[++i]);
+            if (options.threads <= 0) {
+                errors << "Invalid number of threads: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--pin") {
+            options.pin = true;
+        } else if (arg == "--output" && i + 1 < argc) {
+            options.output.path = argv[++i];
+        } else if (arg == "--output-format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "text") {
+                options.output.format = OutputFormat::Text;
+            } else if (format == "binary") {
+                options.output.format = OutputFormat::Binary;
+            } else if (format == "mpiio") {
+                options.output.format = OutputFormat::MpiIo;
+            } else {
+                errors << "Unknown output format: " << format << std::endl;
+                return false;
+            }
+        } else if (arg == "--strassen") {
+            options.strassen = strassenCutoff();
+        } else if (arg == "--strassen-cutoff" && i + 1 < argc) {
+            options.strassen = std::atoi(argv[++i]);
+            if (options.strassen <= 0) {
+                errors << "Invalid Strassen cutoff: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--no-structure") {
+            options.structure = false;
+        } else if (arg == "--sparse") {
+            options.sparse = SparseMode::Always;
+        } else if (arg == "--dense") {
+            options.sparse = SparseMode::Never;
+        } else if (arg == "--sparse-threshold" && i + 1 < argc) {
+            options.sparseThreshold = std::atof(argv[++i]);
+            if (options.sparseThreshold < 0 || options.sparseThreshold > 1) {
+                errors << "Invalid sparse threshold: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--summa") {
+            options.summa = true;
+        } else if (arg == "--block-size" && i + 1 < argc) {
+            options.blockSize = std::atoi(argv[++i]);
+            if (options.blockSize <= 0) {
+                errors << "Invalid block size: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--pipeline") {
+            options.pipeline = true;
+        } else if (arg == "--panel-width" && i + 1 < argc) {
+            options.pipeline = true;
+            options.panelWidth = std::atoi(argv[++i]);
+            if (options.panelWidth <= 0) {
+                errors << "Invalid panel width: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--bcast-segment" && i + 1 < argc) {
+            std::string value = argv[++i];
+            options.bcastSegment = value == "auto" ? -1 : std::atoll(value.c_str());
+            if (value != "auto" && options.bcastSegment < 0) {
+                errors << "Invalid broadcast segment: " << value << std::endl;
+                return false;
+            }
+        } else {
+            errors << "Unknown option: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (options.summa) {
+        // SUMMA deals dense blocks; sparse inputs are expanded on rank 0
+        options.sparse = SparseMode::Never;
+    }
+    if (options.pipeline && options.strassen > 0) {
+        // The panels of the pipeline are far below any useful Strassen cutoff
+        errors << "--pipeline cannot be combined with --strassen" << std::endl;
+        return false;
+    }
+    if (options.summa && options.strassen > 0) {
+        // SUMMA accumulates one panel product at a time, with the classical kernel
+        errors << "--summa cannot be combined with --strassen" << std::endl;
+        return false;
+    }
+    if (options.output.path.empty() && options.output.format != OutputFormat::Text) {
+        errors << "--output-format " << (options.output.format == OutputFormat::Binary ? "binary" : "mpiio")
+                  << " needs --output PATH" << std::endl;
+        return false;
     }
-    
-    infile >> rows >> cols;
-    matrix.resize(rows, std::vector<int>(cols));
+    return true;
+}
+
+/*
+ * The input matrices. When both files are binary every rank reads its own part with
+ * MPI-IO (`parallel`), with the element type of the file headers; otherwise rank 0
+ * loads A and B in full as int and distributes them, in CSR form for the sparse ones.
+ */
+struct Inputs {
+    std::string pathA;
+    std::string pathB;
+    bool parallel = false;
+    DType dtype = DType::Int32;
+    int rowsA = 0;
+    int colsA = 0;
+    int colsB = 0;
+    bool sparseA = false; // A goes through the sparse kernels
+    bool sparseB = false;
+    Matrix<int> A; // rank 0 only, when not parallel and not sparse
+    Matrix<int> B;
+    CsrMatrix<int> csrA; // rank 0 only, when sparse
+    CsrMatrix<int> csrB;
+    MatrixCache* cache = nullptr; // service mode only
+    bool cacheB = false; // B is looked up in (or added to) the cache under keyB
+    std::string keyB;
+};
+
+// Rank 0: loads a text or Matrix Market input, as CSR when it is sparse enough
+void loadInput(const std::string& path, const Options& options, Matrix<int>& dense, CsrMatrix<int>& csr,
+               bool& sparse) {
+    if (isMatrixMarketFile(path)) {
+        csr = readMatrixMarket(path);
+        const double fill = csr.rows > 0 && csr.cols > 0
+                                ? static_cast<double>(csr.nnz()) / (static_cast<double>(csr.rows) * csr.cols)
+                                : 0.0;
+        sparse = options.sparse == SparseMode::Always ||
+                 (options.sparse == SparseMode::Auto && fill < options.sparseThreshold);
+        if (!sparse) {
+            dense = toDense(csr);
+            csr = CsrMatrix<int>();
+        }
+    } else if (options.sparse == SparseMode::Always && !isBinaryMatrixFile(path)) {
+        csr = readMatrixTextSparse(path);
+        sparse = true;
+    } else {
+        dense = readMatrix(path, options.verify, options.readThreads);
+        sparse = options.sparse == SparseMode::Always ||
+                 (options.sparse == SparseMode::Auto && density<int>(dense) < options.sparseThreshold);
+        if (sparse) {
+            csr = toCsr<int>(dense);
+            dense = Matrix<int>();
+        }
+    }
+}
 
+// The int matrix loaded by rank 0 as a Matrix<T> (text inputs only ever run as int)
+template <typename T>
+Matrix<T> rootInput(Matrix<int>& m) {
+    if constexpr (std::is_same_v<T, int>) {
+        return std::move(m);
+    } else {
+        Matrix<T> converted(m.rows(), m.cols());
+        for (int i = 0; i < m.rows(); ++i) {
+            std::copy_n(m.row(i), m.cols(), converted.row(i));
+        }
+        return converted;
+    }
+}
+
+// Synthetic int input for the scaling runs: values in [-9, 9], the same for the same seed
+Matrix<int> randomInput(int rows, int cols, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<> dis(-9, 9);
+    Matrix<int> m(rows, cols);
     for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            infile >> matrix[i][j];
+        std::generate_n(m.row(i), cols, [&] { return dis(gen); });
+    }
+    return m;
+}
+
+// Broadcasts a string from root; the other ranks get its contents in s
+void broadcastString(std::string& s, int root, MPI_Comm comm) {
+    PROFILE_SCOPE(Region::Broadcast);
+    int length = static_cast<int>(s.size());
+    MPI_Bcast(&length, 1, MPI_INT, root, comm);
+    s.resize(length);
+    MPI_Bcast(&s[0], length, MPI_CHAR, root, comm);
+}
+
+// An I/O step of the job failed; thrown on every rank alike, so that all of them give up
+// the job together and the service keeps running
+struct JobError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// Runs an I/O step on every rank (a rank with nothing to do passes an empty one) and agrees
+// on its outcome: if it threw on any rank, every rank throws JobError with the message of
+// the lowest failing rank
+template <typename Step>
+void collectively(Step step) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    std::string message;
+    int failed = size;
+    try {
+        step();
+    } catch (const std::exception& e) {
+        message = e.what();
+        failed = rank;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (failed < size) {
+        broadcastString(message, failed, MPI_COMM_WORLD);
+        throw JobError(message);
+    }
+}
+
+// Writes the gathered C from rank 0. Collective, so that every rank learns if it failed.
+template <typename Acc>
+void writeResult(const Matrix<Acc>& C, const Output& out, RunStats& stats) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    collectively([&] {
+        if (rank != 0) {
+            return;
+        }
+        const double outputStart = MPI_Wtime();
+        if (out.path.empty()) {
+            std::cout << "Congratulations, bro. Here is your resultant matrix C:" << std::endl;
+            printMatrix<Acc>(STDOUT_FILENO, C);
+        } else if (out.format == OutputFormat::Binary) {
+            writeMatrixBinary<Acc>(out.path, C);
+        } else {
+            writeMatrixText<Acc>(out.path, C);
+        }
+        stats.output = MPI_Wtime() - outputStart;
+    });
+}
+
+// Local product of a rank, whose A holds the rows from rowOffset of the full A. Structured
+// inputs are dispatched first; Strassen-Winograd is only built for int.
+template <typename T, typename Acc>
+void multiplyLocal(const Matrix<T>& A, const Matrix<T>& B, Matrix<Acc>& C, int strassen, bool structure,
+                   int rowOffset) {
+    PROFILE_SCOPE(Region::Multiply, 2.0 * A.rows() * A.cols() * B.cols());
+    if (structure && multiplyStructured<T, Acc>(A, B, C, rowOffset)) {
+        return;
+    }
+    if constexpr (std::is_same_v<T, int> && std::is_same_v<Acc, int>) {
+        if (strassen > 0) {
+            multiplyStrassen(A, B, C, strassen);
+            return;
         }
     }
+    multiplyMatrices<T, Acc>(A, B, C);
 }
 
-int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+// Writes the row blocks of C: collectively with MPI-IO, or gathered on rank 0
+template <typename Acc>
+void writeRowBlocks(const Matrix<Acc>& localC, int rowsA, const RowPartition& rows, const Output& out,
+                    RunStats& stats) {
+    if (out.format == OutputFormat::MpiIo) {
+        const double outputStart = MPI_Wtime();
+        collectively([&] { writeRowBlockAll(out.path, localC, rowsA, rows, MPI_COMM_WORLD); });
+        stats.output = MPI_Wtime() - outputStart;
+        return;
+    }
+
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    Matrix<Acc> C;
+    if (rank == 0) {
+        C = Matrix<Acc>(rowsA, localC.cols());
+    }
+    const double gatherStart = MPI_Wtime();
+    gatherRows(localC, C, rows, 0, MPI_COMM_WORLD);
+    stats.gather = MPI_Wtime() - gatherStart;
+    writeResult(C, out, stats);
+}
+
+// Row-block product: each rank gets a block of rows of A and the whole B, and computes
+// the same rows of C. With more ranks than rows, the trailing ranks own zero rows.
+// With a panel width the product is pipelined (multiplyPipelined): B broadcast from rank 0
+// goes out in column panels and the blocks of C stream back to rank 0 as they are done.
+template <typename T, typename Acc>
+void multiplyRowBlocks(Inputs& in, long long bcastSegment, int strassen, bool structure, int panelWidth,
+                       const Output& out, RunStats& stats) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    RowPartition rows = RowPartition::balanced(in.rowsA, size);
+    // A B cached by an earlier job of the service is already on every rank
+    std::shared_ptr<const Matrix<T>> B = in.cacheB ? in.cache->find<T>(in.keyB) : nullptr;
+    const bool loadB = B == nullptr;
+    const bool pipelineB = panelWidth > 0 && loadB && !in.parallel;
+    Matrix<T> localA, fullB;
+    const double distributeStart = MPI_Wtime();
+    if (in.parallel) {
+        collectively([&] { localA = readRowBlockAll<T>(in.pathA, in.rowsA, in.colsA, rows, MPI_COMM_WORLD); });
+        if (loadB) {
+            collectively([&] { fullB = readMatrixAll<T>(in.pathB, in.colsA, in.colsB, MPI_COMM_WORLD); });
+        }
+        stats.read += MPI_Wtime() - distributeStart;
+    } else {
+        localA = scatterRows(rootInput<T>(in.A), in.colsA, rows, 0, MPI_COMM_WORLD);
+        if (loadB) {
+            fullB = rank == 0 ? rootInput<T>(in.B) : Matrix<T>(in.colsA, in.colsB);
+        }
+        if (loadB && !pipelineB) {
+            std::size_t segment = bcastSegment >= 0 ? static_cast<std::size_t>(bcastSegment)
+                                                    : tuneBroadcastSegment(fullB.size() * sizeof(T), 0, MPI_COMM_WORLD);
+            broadcastMatrix(fullB, 0, MPI_COMM_WORLD, segment);
+        }
+        stats.distribute = MPI_Wtime() - distributeStart;
+    }
+    if (loadB) {
+        B = std::make_shared<const Matrix<T>>(std::move(fullB));
+    }
+    const int rowsA = in.rowsA;
+    const int colsB = in.colsB;
+
+    const double computeStart = MPI_Wtime();
+    Matrix<Acc> localC(localA.rows(), colsB);
+    stats.localRows = localC.rows();
+    if (panelWidth > 0) {
+        const bool gather = out.format != OutputFormat::MpiIo;
+        Matrix<Acc> C;
+        if (gather && rank == 0) {
+            C = Matrix<Acc>(rowsA, colsB);
+        }
+        const double waited = multiplyPipelined<T, Acc>(localA, *B, localC, C, rows, panelWidth, pipelineB, gather,
+                                                        structure, 0, MPI_COMM_WORLD);
+        // Time blocked in the pipelined transfers counts as distribution
+        stats.compute = MPI_Wtime() - computeStart - waited;
+        stats.distribute += waited;
+        if (!gather) {
+            writeRowBlocks(localC, rowsA, rows, out, stats);
+        } else {
+            writeResult(C, out, stats);
+        }
+    } else {
+        multiplyLocal(localA, *B, localC, strassen, structure, rows.offsets[rank]);
+        stats.compute = MPI_Wtime() - computeStart;
+        writeRowBlocks(localC, rowsA, rows, out, stats);
+    }
+    if (loadB && in.cacheB) {
+        in.cache->insert(in.keyB, B);
+    }
+}
 
+// Row-block product with a sparse A or B (int inputs only): the CSR rows of A are
+// scattered, or a CSR B is broadcast, and every rank runs the matching sparse kernel
+template <typename Acc>
+void multiplySparseRowBlocks(Inputs& in, long long bcastSegment, const Output& out, RunStats& stats) {
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    if (size != 2) {
+    RowPartition rows = RowPartition::balanced(in.rowsA, size);
+    CsrMatrix<int> localCsr, csrB;
+    Matrix<int> localA, B;
+    const double distributeStart = MPI_Wtime();
+    if (in.sparseA) {
+        localCsr = scatterCsrRows(in.csrA, in.colsA, rows, 0, MPI_COMM_WORLD);
+    } else {
+        localA = scatterRows(in.A, in.colsA, rows, 0, MPI_COMM_WORLD);
+    }
+    if (in.sparseB) {
         if (rank == 0) {
-            std::cerr << "This application is meant to be run with 2 MPI processes. Non esageriamo con le risorse. State molto calmi!" << std::endl;
+            csrB = std::move(in.csrB);
         }
-        MPI_Finalize();
-        return -1;
+        broadcastCsr(csrB, 0, MPI_COMM_WORLD);
+    } else {
+        B = rank == 0 ? std::move(in.B) : Matrix<int>(in.colsA, in.colsB);
+        std::size_t segment = bcastSegment >= 0 ? static_cast<std::size_t>(bcastSegment)
+                                                : tuneBroadcastSegment(B.size() * sizeof(int), 0, MPI_COMM_WORLD);
+        broadcastMatrix(B, 0, MPI_COMM_WORLD, segment);
+    }
+    stats.distribute = MPI_Wtime() - distributeStart;
+
+    const double computeStart = MPI_Wtime();
+    Matrix<Acc> localC(rows.counts[rank], in.colsB);
+    if (in.sparseA && in.sparseB) {
+        localC = toDense(multiplySparse<int, Acc>(localCsr, csrB));
+    } else if (in.sparseA) {
+        multiplySparseDense<int, Acc>(localCsr, B, localC);
+    } else {
+        multiplyDenseSparse<int, Acc>(localA, toCsc(csrB), localC);
     }
+    stats.compute = MPI_Wtime() - computeStart;
+    stats.localRows = localC.rows();
 
-    int rowsA, colsA, rowsB, colsB;
-    std::vector<std::vector<int>> A, B;
+    writeRowBlocks(localC, in.rowsA, rows, out, stats);
+}
 
+// SUMMA product: A, B and C are spread block-cyclically over a 2D grid, so no rank
+// other than the root ever holds a whole matrix
+template <typename T, typename Acc>
+void multiplySummaOnGrid(Inputs& in, int blockSize, const Output& out, RunStats& stats, const ProcessGrid& grid) {
+    const int rowsA = in.rowsA;
+    const int colsA = in.colsA;
+    const int colsB = in.colsB;
+    BlockCyclicLayout layoutA{rowsA, colsA, blockSize};
+    BlockCyclicLayout layoutB{colsA, colsB, blockSize};
+    BlockCyclicLayout layoutC{rowsA, colsB, blockSize};
+
+    Matrix<T> localA, localB;
+    const double distributeStart = MPI_Wtime();
+    if (in.parallel) {
+        collectively([&] { localA = readBlockCyclicAll<T>(in.pathA, layoutA, grid); });
+        collectively([&] { localB = readBlockCyclicAll<T>(in.pathB, layoutB, grid); });
+        stats.read += MPI_Wtime() - distributeStart;
+    } else {
+        localA = scatterBlockCyclic(rootInput<T>(in.A), layoutA, grid, 0);
+        localB = scatterBlockCyclic(rootInput<T>(in.B), layoutB, grid, 0);
+        stats.distribute = MPI_Wtime() - distributeStart;
+    }
+    Matrix<Acc> localC(layoutC.localRows(grid), layoutC.localCols(grid));
+
+    const double computeStart = MPI_Wtime();
+    summaMultiply<T, Acc>(localA, localB, localC, colsA, blockSize, grid);
+    stats.compute = MPI_Wtime() - computeStart;
+    stats.localRows = localC.rows();
+
+    if (out.format == OutputFormat::MpiIo) {
+        const double outputStart = MPI_Wtime();
+        collectively([&] { writeBlockCyclicAll(out.path, localC, layoutC, grid); });
+        stats.output = MPI_Wtime() - outputStart;
+        return;
+    }
+
+    Matrix<Acc> C;
+    int rank;
+    MPI_Comm_rank(grid.comm, &rank);
     if (rank == 0) {
-        readMatrixFromFile("matrixA.txt", A, rowsA, colsA);
-        readMatrixFromFile("matrixB.txt", B, rowsB, colsB);
+        C = Matrix<Acc>(rowsA, colsB);
+    }
+    const double gatherStart = MPI_Wtime();
+    gatherBlockCyclic(localC, C, layoutC, grid, 0);
+    stats.gather = MPI_Wtime() - gatherStart;
+    // Grid rank 0 is rank 0 of MPI_COMM_WORLD, which writes the result
+    writeResult(C, out, stats);
+}
+
+// The grid is freed whether or not the job fails
+template <typename T, typename Acc>
+void multiplySumma(Inputs& in, int blockSize, const Output& out, RunStats& stats) {
+    ProcessGrid grid = ProcessGrid::create(MPI_COMM_WORLD);
+    try {
+        multiplySummaOnGrid<T, Acc>(in, blockSize, out, stats, grid);
+    } catch (const JobError&) {
+        grid.free();
+        throw;
+    }
+    grid.free();
+}
+
+template <typename T, typename Acc>
+void multiply(Inputs& in, const Options& options, RunStats& stats) {
+    if constexpr (std::is_same_v<T, int>) {
+        if (in.sparseA || in.sparseB) {
+            multiplySparseRowBlocks<Acc>(in, options.bcastSegment, options.output, stats);
+            return;
+        }
+    }
+    if (options.summa) {
+        multiplySumma<T, Acc>(in, options.blockSize, options.output, stats);
+    } else {
+        const int panelWidth =
+            options.pipeline ? (options.panelWidth > 0 ? options.panelWidth : pipelinePanelWidth(in.colsB)) : 0;
+        multiplyRowBlocks<T, Acc>(in, options.bcastSegment, options.strassen, options.structure, panelWidth,
+                                  options.output, stats);
+    }
+}
+
+// Runs the multiply instantiated for the input type and accumulator type; returns false
+// if that pair is not one of those listed in matrix_multiplication.h
+bool dispatchMultiply(DType type, DType acc, Inputs& in, const Options& options, RunStats& stats) {
+    using std::int8_t, std::int16_t, std::int32_t, std::int64_t;
+    switch (type) {
+    case DType::Int8:
+        if (acc == DType::Int32) {
+            multiply<int8_t, int32_t>(in, options, stats);
+        } else if (acc == DType::Int64) {
+            multiply<int8_t, int64_t>(in, options, stats);
+        } else {
+            return false;
+        }
+        return true;
+    case DType::Int16:
+        if (acc == DType::Int32) {
+            multiply<int16_t, int32_t>(in, options, stats);
+        } else if (acc == DType::Int64) {
+            multiply<int16_t, int64_t>(in, options, stats);
+        } else {
+            return false;
+        }
+        return true;
+    case DType::Int32:
+        if (acc == DType::Int32) {
+            multiply<int32_t, int32_t>(in, options, stats);
+        } else if (acc == DType::Int64) {
+            multiply<int32_t, int64_t>(in, options, stats);
+        } else {
+            return false;
+        }
+        return true;
+    case DType::Int64:
+        if (acc != DType::Int64) {
+            return false;
+        }
+        multiply<int64_t, int64_t>(in, options, stats);
+        return true;
+    case DType::Float32:
+        if (acc == DType::Float32) {
+            multiply<float, float>(in, options, stats);
+        } else if (acc == DType::Float64) {
+            multiply<float, double>(in, options, stats);
+        } else {
+            return false;
+        }
+        return true;
+    case DType::Float64:
+        if (acc != DType::Float64) {
+            return false;
+        }
+        multiply<double, double>(in, options, stats);
+        return true;
+    }
+    return false;
+}
+
+// Accumulator used without --accumulate: int32 for int8/int16 inputs, the input type otherwise
+DType defaultAccumulator(DType type) {
+    return type == DType::Int8 || type == DType::Int16 ? DType::Int32 : type;
+}
+
+/*
+ * Chain product of the --chain files (int32, read on rank 0) in one job: the order is
+ * planned on every rank from the broadcast dimensions, and the rows of the result end up
+ * distributed like C in the row-block product. Returns false if a file cannot be read or
+ * the shapes do not chain.
+ */
+bool multiplyChainJob(const Options& options, RunStats& stats, std::ostream& errors) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    const int count = static_cast<int>(options.chain.size()) + 1;
+    std::vector<Matrix<int>> factors;
+    std::vector<int> dims;
+    bool loaded = true;
+    if (rank == 0) {
+        const double readStart = MPI_Wtime();
+        try {
+            for (const std::string& path : options.chain) {
+                factors.push_back(readMatrix(path, options.verify, options.readThreads));
+            }
+            stats.read = MPI_Wtime() - readStart;
+            dims.push_back(factors.front().rows());
+            for (const Matrix<int>& factor : factors) {
+                dims.push_back(dims.back() == factor.rows() ? factor.cols() : -1);
+            }
+        } catch (const std::exception& e) {
+            errors << e.what() << std::endl;
+            loaded = false;
+            dims.assign(count, -1);
+        }
     }
+    dims.resize(count);
+    {
+        PROFILE_SCOPE(Region::Broadcast);
+        MPI_Bcast(dims.data(), count, MPI_INT, 0, MPI_COMM_WORLD);
+    }
+    if (std::find(dims.begin(), dims.end(), -1) != dims.end()) {
+        if (rank == 0 && loaded) {
+            errors << "Incompatible matrix dimensions in the chain" << std::endl;
+        }
+        return false;
+    }
+
+    const ChainPlan plan(dims);
+    stats.rows = dims.front();
+    stats.cols = dims.back();
+    stats.operations = 2.0 * static_cast<double>(plan.cost());
+    if (rank == 0 && options.timing) {
+        std::printf("Chain order %s: %lld multiply-adds (%lld left to right)\n", plan.toString().c_str(), plan.cost(),
+                    plan.leftToRightCost());
+    }
+    const double computeStart = MPI_Wtime();
+    Matrix<int> localC = multiplyChainAll(factors, plan, 0, MPI_COMM_WORLD);
+    stats.compute = MPI_Wtime() - computeStart;
+    stats.localRows = localC.rows();
 
-    
-    MPI_Bcast(&rowsA, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Bcast(&colsA, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Bcast(&rowsB, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Bcast(&colsB, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    writeRowBlocks(localC, dims.front(), RowPartition::balanced(dims.front(), size), options.output, stats);
+    return true;
+}
 
-    
+/*
+ * Timing report of a job. With --timing, rank 0 prints the time every rank spent in each
+ * phase and the wall time; with --csv it appends one row to the CSV file, holding the
+ * slowest rank of every phase (the phase's share of the critical path). A new file starts
+ * with the header line.
+ */
+void reportTiming(const RunStats& stats, double wall, const Options& options) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    constexpr int FIELDS = 6;
+    double local[FIELDS] = {static_cast<double>(stats.localRows), stats.read, stats.distribute, stats.compute,
+                            stats.gather, stats.output};
+    std::vector<double> all(rank == 0 ? FIELDS * size : 0);
+    MPI_Gather(local, FIELDS, MPI_DOUBLE, all.data(), FIELDS, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    double maxWall;
+    MPI_Reduce(&wall, &maxWall, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
     if (rank != 0) {
-        A.resize(rowsA, std::vector<int>(colsA));
+        return;
     }
-    for (int i = 0; i < rowsA; ++i) {
-        MPI_Bcast(A[i].data(), colsA, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (options.timing) {
+        std::printf("Timing report on %d ranks\n", size);
+        std::printf("%6s %10s %12s %14s %12s %12s %12s\n", "rank", "rows", "read[s]", "distribute[s]", "compute[s]",
+                    "gather[s]", "output[s]");
+        for (int r = 0; r < size; ++r) {
+            const double* t = &all[FIELDS * r];
+            std::printf("%6d %10.0f %12.6f %14.6f %12.6f %12.6f %12.6f\n", r, t[0], t[1], t[2], t[3], t[4], t[5]);
+        }
+        std::printf("wall time %.6f s\n", maxWall);
+    }
+
+    if (!options.csv.empty()) {
+        double slowest[FIELDS] = {};
+        for (int r = 0; r < size; ++r) {
+            for (int f = 1; f < FIELDS; ++f) {
+                slowest[f] = std::max(slowest[f], all[FIELDS * r + f]);
+            }
+        }
+        const bool header = access(options.csv.c_str(), F_OK) != 0;
+        std::FILE* file = std::fopen(options.csv.c_str(), "a");
+        if (file == nullptr) {
+            std::cerr << "Error writing " << options.csv << std::endl;
+            return;
+        }
+        if (header) {
+            std::fprintf(file, "label,ranks,threads,rows,inner,cols,read,distribute,compute,gather,write,wall,gops\n");
+        }
+        std::fprintf(file, "%s,%d,%d,%d,%d,%d,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.3f\n", options.csvLabel.c_str(), size,
+                     ThreadPool::global().size(), stats.rows, stats.inner, stats.cols, slowest[1], slowest[2],
+                     slowest[3], slowest[4], slowest[5], maxWall, maxWall > 0 ? stats.operations / maxWall * 1e-9 : 0.0);
+        std::fclose(file);
     }
+}
 
-    
+/*
+ * Profile of a job: the regions of every rank are reduced on rank 0, which prints the
+ * one-line summary with --profile and writes the JSON summary with --profile-json.
+ * Profiling is turned off again.
+ */
+void reportProfile(const Options& options) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    const ProfileSummary summary = reduceProfile(0, MPI_COMM_WORLD);
+    setProfiling(false);
     if (rank != 0) {
-        B.resize(rowsB, std::vector<int>(colsB));
+        return;
+    }
+    if (options.profile) {
+        std::printf("%s\n", profileLine(summary).c_str());
+    }
+    if (!options.profileJson.empty() && !writeProfileJson(options.profileJson, summary)) {
+        std::cerr << "Error writing " << options.profileJson << std::endl;
+    }
+}
+
+// Timeline of a job: the events of every rank merged by rank 0 into the --trace file
+void reportTrace(const Options& options) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    const bool written = writeTrace(options.trace, 0, MPI_COMM_WORLD);
+    setTracing(false);
+    if (rank == 0 && !written) {
+        std::cerr << "Error writing " << options.trace << std::endl;
+    }
+}
+
+/*
+ * One job: the chain, or the product of A and B, with the timing, profile and trace
+ * reports if asked for. Errors found by rank 0 before the multiply (unreadable inputs,
+ * incompatible shapes) and I/O errors of the distributed steps, which the ranks agree on
+ * (collectively), are written to `errors` by rank 0 and make every rank return false. With
+ * a cache (service mode), a dense B of the row-block product is kept on every rank for the
+ * later jobs that use the same file.
+ */
+bool runJob(const Options& options, MatrixCache* cache, std::ostream& errors) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    const bool report = options.timing || !options.csv.empty();
+    const bool profile = options.profile || !options.profileJson.empty();
+    if (!setProfiling(profile, options.profileCounters) && rank == 0) {
+        std::cerr << "Hardware counters unavailable, profiling without them" << std::endl;
+    }
+    setTracing(!options.trace.empty());
+    if (!options.chain.empty()) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        const double start = MPI_Wtime();
+        RunStats stats;
+        bool ok;
+        try {
+            ok = multiplyChainJob(options, stats, errors);
+        } catch (const JobError& e) {
+            if (rank == 0) {
+                errors << e.what() << std::endl;
+            }
+            ok = false;
+        }
+        const double end = MPI_Wtime();
+        if (ok && report) {
+            reportTiming(stats, end - start, options);
+        }
+        if (ok && profile) {
+            reportProfile(options);
+        }
+        if (ok && !options.trace.empty()) {
+            reportTrace(options);
+        }
+        return ok;
+    }
+
+    Inputs in;
+    in.pathA = options.pathA;
+    in.pathB = options.pathB;
+    in.cache = cache;
+    int rowsB = 0;
+    bool loaded = true;
+    RunStats stats;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    const double start = MPI_Wtime();
+
+    // Rank 0 looks at the inputs: binary files only need their headers, text files are read
+    // in full, except for a B that is already cached, and synthetic inputs are generated
+    if (rank == 0) {
+        try {
+            in.parallel = options.generate.empty() && isBinaryMatrixFile(in.pathA) && isBinaryMatrixFile(in.pathB);
+            if (!options.generate.empty()) {
+                in.rowsA = options.generate[0];
+                in.colsA = rowsB = options.generate[1];
+                in.colsB = options.generate[2];
+                in.A = randomInput(in.rowsA, in.colsA, options.seed);
+                in.B = randomInput(rowsB, in.colsB, options.seed + 1);
+            } else if (in.parallel) {
+                // The ranks read only their parts of the payloads, so the checksums are checked here
+                if (options.verify) {
+                    verifyMatrixFile(in.pathA);
+                    verifyMatrixFile(in.pathB);
+                }
+                MatrixFileHeader headerA = readMatrixHeader(in.pathA);
+                MatrixFileHeader headerB = readMatrixHeader(in.pathB);
+                if (headerA.dtype != headerB.dtype) {
+                    throw std::runtime_error(std::string("Element types differ: ") + dtypeName(headerA.dtype) +
+                                             " * " + dtypeName(headerB.dtype));
+                }
+                in.dtype = headerA.dtype;
+                in.rowsA = static_cast<int>(headerA.rows);
+                in.colsA = static_cast<int>(headerA.cols);
+                rowsB = static_cast<int>(headerB.rows);
+                in.colsB = static_cast<int>(headerB.cols);
+                in.keyB = cache != nullptr && !options.summa ? fileCacheKey(in.pathB) : std::string();
+                in.cacheB = !in.keyB.empty();
+            } else {
+                loadInput(in.pathA, options, in.A, in.csrA, in.sparseA);
+                in.rowsA = in.sparseA ? in.csrA.rows : in.A.rows();
+                in.colsA = in.sparseA ? in.csrA.cols : in.A.cols();
+                if (cache != nullptr && !options.summa && options.sparse != SparseMode::Always && !in.sparseA) {
+                    in.keyB = fileCacheKey(in.pathB);
+                }
+                std::shared_ptr<const Matrix<int>> cachedB =
+                    in.keyB.empty() ? nullptr : cache->peek<int>(in.keyB);
+                if (cachedB != nullptr) {
+                    rowsB = cachedB->rows();
+                    in.colsB = cachedB->cols();
+                } else {
+                    loadInput(in.pathB, options, in.B, in.csrB, in.sparseB);
+                    rowsB = in.sparseB ? in.csrB.rows : in.B.rows();
+                    in.colsB = in.sparseB ? in.csrB.cols : in.B.cols();
+                }
+                in.cacheB = !in.keyB.empty() && !in.sparseB;
+            }
+        } catch (const std::exception& e) {
+            errors << e.what() << std::endl;
+            loaded = false;
+        }
+        stats.read = MPI_Wtime() - start;
+    }
+
+    int header[10] = {in.rowsA,     in.colsA,   rowsB,      in.colsB,  in.parallel, static_cast<int>(in.dtype),
+                      in.sparseA, in.sparseB, in.cacheB, loaded};
+    {
+        PROFILE_SCOPE(Region::Broadcast);
+        MPI_Bcast(header, 10, MPI_INT, 0, MPI_COMM_WORLD);
+    }
+    if (header[9] == 0) {
+        return false;
+    }
+    in.rowsA = header[0];
+    in.colsA = header[1];
+    rowsB = header[2];
+    in.colsB = header[3];
+    in.parallel = header[4] != 0;
+    in.dtype = static_cast<DType>(header[5]);
+    in.sparseA = header[6] != 0;
+    in.sparseB = header[7] != 0;
+    in.cacheB = header[8] != 0;
+    if (in.cacheB) {
+        broadcastString(in.keyB, 0, MPI_COMM_WORLD);
+    }
+
+    if (in.colsA != rowsB) {
+        if (rank == 0) {
+            errors << "Incompatible matrix dimensions: " << in.rowsA << "x" << in.colsA << " * " << rowsB << "x"
+                   << in.colsB << std::endl;
+        }
+        return false;
+    }
+
+    DType acc = defaultAccumulator(in.dtype);
+    if (!options.accumulate.empty()) {
+        parseDType(options.accumulate, acc);
+    }
+    stats.rows = in.rowsA;
+    stats.inner = in.colsA;
+    stats.cols = in.colsB;
+    stats.operations = 2.0 * in.rowsA * in.colsA * in.colsB;
+    // Strassen-Winograd is only built for dense int32 products accumulated in int32; the
+    // element type and the sparsity are only known once the inputs have been looked at
+    if (options.strassen > 0 && (in.dtype != DType::Int32 || acc != DType::Int32)) {
+        if (rank == 0) {
+            errors << "--strassen needs int32 inputs with an int32 accumulator, not " << dtypeName(in.dtype)
+                   << " with " << dtypeName(acc) << std::endl;
+        }
+        return false;
+    }
+    if (options.strassen > 0 && (in.sparseA || in.sparseB)) {
+        if (rank == 0) {
+            errors << "--strassen cannot be used with sparse inputs; pass --dense to expand them" << std::endl;
+        }
+        return false;
+    }
+    bool supported;
+    try {
+        supported = dispatchMultiply(in.dtype, acc, in, options, stats);
+    } catch (const JobError& e) {
+        if (rank == 0) {
+            errors << e.what() << std::endl;
+        }
+        return false;
+    }
+    if (!supported) {
+        if (rank == 0) {
+            errors << "Unsupported accumulator " << dtypeName(acc) << " for " << dtypeName(in.dtype) << " inputs"
+                   << std::endl;
+        }
+        return false;
+    }
+    const double end = MPI_Wtime();
+
+    if (report) {
+        reportTiming(stats, end - start, options);
+    }
+    if (profile) {
+        reportProfile(options);
+    }
+    if (!options.trace.empty()) {
+        reportTrace(options);
+    }
+    return true;
+}
+
+// Rank 0: why a job sent to the service cannot run, or an empty string
+std::string rejectJob(const Options& job) {
+    if (!job.serve.empty() || job.autotune) {
+        return "--serve and --autotune are not jobs";
+    }
+    if (job.threads > 0 || job.pin) {
+        return "--threads and --pin are set when the service starts";
+    }
+    if (job.output.path.empty()) {
+        return "jobs of the service need --output PATH";
     }
-    for (int i = 0; i < rowsB; ++i) {
-        MPI_Bcast(B[i].data(), colsB, MPI_INT, 0, MPI_COMM_WORLD);
+    // Caught before the inputs are read and the product computed for nothing
+    const std::string& path = job.output.path;
+    const std::size_t slash = path.rfind('/');
+    const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    if (access(path.c_str(), F_OK) == 0 ? access(path.c_str(), W_OK) != 0 : access(dir.c_str(), W_OK) != 0) {
+        return "cannot write " + path;
     }
+    return std::string();
+}
 
-    std::vector<std::vector<int>> C(rowsA, std::vector<int>(colsB, 0));
-    multiplyMatrices(A, B, C, rowsA, colsA, colsB);
+/*
+ * Service mode: the ranks stay up and rank 0 takes one request at a time from the socket,
+ * either a job (the same arguments as a single run) or "--stats" / "--shutdown". Every
+ * request is broadcast so that all ranks run the same jobs in the same order, and the
+ * caches of B of the ranks stay in step.
+ */
+bool serve(const Options& options) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
+    int listener = -1;
     if (rank == 0) {
-        std::cout << "Congratulations, bro. Here is your resultant matrix C:" << std::endl;
-        for (const auto& row : C) {
-            for (const auto& elem : row) {
-                std::cout << elem << " ";
+        try {
+            listener = listenSocket(options.serve);
+            std::cout << "Serving on " << options.serve << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+    MPI_Bcast(&listener, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (listener < 0) {
+        return false;
+    }
+
+    MatrixCache cache(options.cacheBytes);
+    for (;;) {
+        int client = -1;
+        std::string request;
+        std::string failure; // rank 0: why the request could not be read
+        if (rank == 0) {
+            try {
+                client = acceptClient(listener);
+                // A client that never finishes its request must not hold up the service
+                setReadTimeout(client, REQUEST_TIMEOUT_MS);
+                for (const std::string& arg : readRequest(client)) {
+                    request += arg + '\n';
+                }
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                failure = e.what();
             }
-            std::cout << std::endl;
+        }
+        broadcastString(request, 0, MPI_COMM_WORLD);
+        std::vector<std::string> args{"main"};
+        std::istringstream lines(request);
+        for (std::string arg; std::getline(lines, arg);) {
+            args.push_back(arg);
+        }
+
+        std::ostringstream reply;
+        bool stop = false;
+        if (args.size() == 2 && args[1] == "--shutdown") {
+            reply << "ok shutting down";
+            stop = true;
+        } else if (args.size() == 2 && args[1] == "--stats") {
+            reply << "ok " << cache.matrices() << " cached matrices, " << (cache.bytes() >> 20) << " MB, "
+                  << cache.hits() << " hits, " << cache.misses() << " misses";
+        } else if (args.size() > 1) {
+            std::vector<char*> argv;
+            for (std::string& arg : args) {
+                argv.push_back(&arg[0]);
+            }
+            Options job;
+            std::ostringstream errors;
+            int accepted = parseOptions(static_cast<int>(argv.size()), argv.data(), job, errors);
+            if (rank == 0 && accepted) {
+                const std::string reason = rejectJob(job);
+                errors << reason;
+                accepted = reason.empty();
+            }
+            MPI_Bcast(&accepted, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+            const double start = MPI_Wtime();
+            const std::uint64_t hits = cache.hits();
+            if (accepted && runJob(job, &cache, errors)) {
+                reply << "ok " << MPI_Wtime() - start << " s" << (cache.hits() > hits ? ", B cached" : "");
+            } else {
+                std::string message = errors.str();
+                while (!message.empty() && message.back() == '\n') {
+                    message.pop_back();
+                }
+                std::replace(message.begin(), message.end(), '\n', ' ');
+                reply << "error: " << message;
+            }
+        } else {
+            reply << "error: " << (failure.empty() ? "empty request" : failure);
+        }
+
+        if (rank == 0 && client >= 0) {
+            try {
+                writeReply(client, reply.str());
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+            close(client);
+        }
+        if (stop) {
+            break;
         }
     }
+    if (rank == 0) {
+        close(listener);
+        unlink(options.serve.c_str());
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    // Only the main thread makes MPI calls; the pool threads just compute
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Every rank parses the options, rank 0 alone reports what is wrong with them
+    Options options;
+    std::ostringstream ignored;
+    if (!parseOptions(argc, argv, options, rank == 0 ? static_cast<std::ostream&>(std::cerr) : ignored)) {
+        MPI_Finalize();
+        return -1;
+    }
+
+    if (options.threads > 0 || options.pin) {
+        ThreadPool::setThreads(options.threads > 0 ? options.threads : ThreadPool::global().size(), options.pin);
+    }
+
+    if (options.autotune) {
+        if (rank == 0) {
+            TileSizes tiles = autotuneTileSizes();
+            setTileSizes(tiles);
+            int cutoff = autotuneStrassenCutoff();
+            if (!saveTileSizes(tileConfigPath(), tiles) || !saveStrassenCutoff(tileConfigPath(), cutoff)) {
+                std::cerr << "Error writing tile config: " << tileConfigPath() << std::endl;
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            std::cout << "Tile sizes mc=" << tiles.mc << " kc=" << tiles.kc << " nc=" << tiles.nc
+                      << ", Strassen cutoff " << cutoff << " saved to " << tileConfigPath() << std::endl;
+        }
+        MPI_Finalize();
+        return 0;
+    }
+
+    const bool ok = options.serve.empty() ? runJob(options, nullptr, std::cerr) : serve(options);
     MPI_Finalize();
-    return 0;
+    return ok ? 0 : -1;
 }
+
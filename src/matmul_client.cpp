@@ -0,0 +1,61 @@
+#include "service.h"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// The service runs in its own directory: relative paths are made absolute here
+std::string absolutePath(const std::string& path) {
+    if (path.empty() || path[0] == '/') {
+        return path;
+    }
+    std::vector<char> cwd(4096);
+    if (getcwd(cwd.data(), cwd.size()) == nullptr) {
+        throw std::runtime_error("Cannot resolve the current directory");
+    }
+    return std::string(cwd.data()) + "/" + path;
+}
+
+} // namespace
+
+// Sends one request to a service started with `main --serve SOCKET` and prints the reply.
+// The request is a job with the options of main (--a, --b, --chain, --output, ...), or
+// --stats or --shutdown. Exits with 0 when the reply is "ok".
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <socket> --stats | --shutdown | <options of main>" << std::endl;
+        return 1;
+    }
+
+    try {
+        std::vector<std::string> args;
+        bool paths = false; // inside the file list of --chain
+        for (int i = 2; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const bool pathOption = arg == "--a" || arg == "--b" || arg == "--output" || arg == "--csv" ||
+                                    arg == "--profile-json" || arg == "--trace";
+            if (arg.rfind("--", 0) == 0) {
+                paths = arg == "--chain";
+                args.push_back(arg);
+                if (pathOption && i + 1 < argc) {
+                    args.push_back(absolutePath(argv[++i]));
+                }
+            } else {
+                args.push_back(paths ? absolutePath(arg) : arg);
+            }
+        }
+
+        const int fd = connectSocket(argv[1]);
+        writeRequest(fd, args);
+        const std::string reply = readReply(fd);
+        close(fd);
+        std::cout << reply << std::endl;
+        return reply.rfind("ok", 0) == 0 ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,107 @@
+#include "matrix_io.h"
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Writes a binary file of T elements holding the values of an int text matrix
+template <typename T>
+void writeAs(const std::string& path, const Matrix<int>& matrix) {
+    Matrix<T> converted(matrix.rows(), matrix.cols());
+    for (int i = 0; i < matrix.rows(); ++i) {
+        for (int j = 0; j < matrix.cols(); ++j) {
+            const int value = matrix(i, j);
+            if (value < std::numeric_limits<T>::lowest() || value > std::numeric_limits<T>::max()) {
+                throw std::runtime_error("Value " + std::to_string(value) + " does not fit the element type");
+            }
+            converted(i, j) = static_cast<T>(value);
+        }
+    }
+    writeMatrixBinary<T>(path, converted);
+}
+
+void textToBinary(const std::string& input, const std::string& output, DType dtype) {
+    Matrix<int> matrix = readMatrixText(input);
+    switch (dtype) {
+    case DType::Int8:
+        writeAs<std::int8_t>(output, matrix);
+        break;
+    case DType::Int16:
+        writeAs<std::int16_t>(output, matrix);
+        break;
+    case DType::Int32:
+        writeMatrixBinary(output, matrix);
+        break;
+    case DType::Int64:
+        writeAs<std::int64_t>(output, matrix);
+        break;
+    case DType::Float32:
+        writeAs<float>(output, matrix);
+        break;
+    case DType::Float64:
+        writeAs<double>(output, matrix);
+        break;
+    }
+}
+
+void binaryToText(const std::string& input, const std::string& output) {
+    switch (readMatrixHeader(input).dtype) {
+    case DType::Int8:
+        writeMatrixText<std::int8_t>(output, mapMatrixBinary<std::int8_t>(input, true));
+        break;
+    case DType::Int16:
+        writeMatrixText<std::int16_t>(output, mapMatrixBinary<std::int16_t>(input, true));
+        break;
+    case DType::Int32:
+        writeMatrixText(output, mapMatrixBinary(input, true));
+        break;
+    case DType::Int64:
+        writeMatrixText<std::int64_t>(output, mapMatrixBinary<std::int64_t>(input, true));
+        break;
+    case DType::Float32:
+        writeMatrixText<float>(output, mapMatrixBinary<float>(input, true));
+        break;
+    case DType::Float64:
+        writeMatrixText<double>(output, mapMatrixBinary<double>(input, true));
+        break;
+    }
+}
+
+} // namespace
+
+// Converts a matrix between the text format (matrixA.txt style) and the binary format.
+// The direction follows the input: binary files become text and text files become binary,
+// with int32 elements unless --dtype picks another element type.
+int main(int argc, char** argv) {
+    DType dtype = DType::Int32;
+    int first = 1;
+    if (argc == 5 && std::string(argv[1]) == "--dtype") {
+        if (!parseDType(argv[2], dtype)) {
+            std::cerr << "Unknown element type: " << argv[2] << std::endl;
+            return 1;
+        }
+        first = 3;
+    }
+    if (argc - first != 2) {
+        std::cerr << "Usage: " << argv[0] << " [--dtype int8|int16|int32|int64|float32|float64] <input> <output>"
+                  << std::endl;
+        return 1;
+    }
+    const std::string input = argv[first];
+    const std::string output = argv[first + 1];
+
+    try {
+        if (isBinaryMatrixFile(input)) {
+            binaryToText(input, output);
+        } else {
+            textToBinary(input, output, dtype);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,711 @@
+#include "matrix_io.h"
+#include "profile.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char MAGIC[4] = {'M', 'M', 'A', 'T'};
+constexpr char MATRIX_MARKET_BANNER[] = "%%MatrixMarket";
+
+std::runtime_error ioError(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + ": " + path);
+}
+
+void checkHeader(const MatrixFileHeader& header, const std::string& path) {
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw ioError("Not a binary matrix file", path);
+    }
+    if (header.version != MATRIX_FILE_VERSION || header.layout != Layout::RowMajor) {
+        throw ioError("Unsupported binary matrix version or layout", path);
+    }
+    if (dtypeSize(header.dtype) == 0) {
+        throw ioError("Unsupported element type", path);
+    }
+    if (header.rows < 0 || header.cols < 0 || header.rows > INT32_MAX || header.cols > INT32_MAX) {
+        throw ioError("Invalid matrix dimensions", path);
+    }
+}
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && isSpace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+// Parses the integer at p (no leading whitespace); returns the position after it, or
+// nullptr if there is no valid int there. A '+' directly followed by a digit is accepted like
+// operator>> does; from_chars would take the '-' of "+-5" as the sign.
+const char* parseInt(const char* p, const char* end, int& value) {
+    if (end - p > 1 && p[0] == '+' && p[1] >= '0' && p[1] <= '9') {
+        ++p;
+    }
+    auto [next, ec] = std::from_chars(p, end, value);
+    if (ec != std::errc() || (next < end && !isSpace(*next))) {
+        return nullptr;
+    }
+    return next;
+}
+
+/*
+ * Serial parser: reads the file in large blocks and converts every complete token of a
+ * block with std::from_chars. A token cut by the end of a block is carried over to the
+ * front of the buffer and completed by the next read.
+ */
+class ChunkedTextParser {
+public:
+    // Parses the file from byte `offset` on
+    explicit ChunkedTextParser(const std::string& path, off_t offset = 0) : path_(path), buffer_(TEXT_CHUNK) {
+        fd_ = open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            throw ioError("Error opening file", path);
+        }
+        if (lseek(fd_, offset, SEEK_SET) != offset) {
+            close(fd_);
+            throw ioError("Error reading file", path);
+        }
+        posix_fadvise(fd_, offset, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    ~ChunkedTextParser() { close(fd_); }
+    ChunkedTextParser(const ChunkedTextParser&) = delete;
+    ChunkedTextParser& operator=(const ChunkedTextParser&) = delete;
+
+    // Parses the next integer token; false at end of file
+    bool next(int& value) {
+        for (;;) {
+            pos_ = skipSpaces(pos_, complete_);
+            if (pos_ < complete_) {
+                pos_ = parseInt(pos_, complete_, value);
+                if (pos_ == nullptr) {
+                    throw ioError("Malformed matrix file", path_);
+                }
+                return true;
+            }
+            if (eof_) {
+                return false;
+            }
+            refill();
+        }
+    }
+
+private:
+    static constexpr std::size_t TEXT_CHUNK = 4 << 20;
+
+    void refill() {
+        const std::size_t carry = end_ - pos_;
+        if (carry == buffer_.size()) {
+            throw ioError("Malformed matrix file", path_);
+        }
+        std::memmove(buffer_.data(), pos_, carry);
+        ssize_t n = read(fd_, buffer_.data() + carry, buffer_.size() - carry);
+        if (n < 0) {
+            throw ioError("Error reading file", path_);
+        }
+        eof_ = n == 0;
+        pos_ = buffer_.data();
+        end_ = buffer_.data() + carry + n;
+
+        // Every token before the last whitespace of the block is complete
+        complete_ = end_;
+        if (!eof_) {
+            while (complete_ > pos_ && !isSpace(complete_[-1])) {
+                --complete_;
+            }
+        }
+    }
+
+    std::string path_;
+    std::vector<char> buffer_;
+    int fd_;
+    const char* pos_ = nullptr;
+    const char* end_ = nullptr;
+    const char* complete_ = nullptr; // end of the last complete token in the buffer
+    bool eof_ = false;
+};
+
+void checkTextDimensions(int rows, int cols, const std::string& path) {
+    if (rows < 0 || cols < 0) {
+        throw ioError("Invalid matrix dimensions", path);
+    }
+}
+
+Matrix<int> parseTextChunked(const std::string& path) {
+    ChunkedTextParser parser(path);
+    int rows, cols;
+    if (!parser.next(rows) || !parser.next(cols)) {
+        throw ioError("Malformed matrix file", path);
+    }
+    checkTextDimensions(rows, cols, path);
+
+    Matrix<int> matrix(rows, cols);
+    for (int i = 0; i < rows; ++i) {
+        int* row = matrix.row(i);
+        for (int j = 0; j < cols; ++j) {
+            if (!parser.next(row[j])) {
+                throw ioError("Malformed matrix file", path);
+            }
+        }
+    }
+    return matrix;
+}
+
+// Dense text file streamed straight into CSR: zeros are dropped as they are parsed
+CsrMatrix<int> parseTextSparse(const std::string& path) {
+    ChunkedTextParser parser(path);
+    int rows, cols;
+    if (!parser.next(rows) || !parser.next(cols)) {
+        throw ioError("Malformed matrix file", path);
+    }
+    checkTextDimensions(rows, cols, path);
+
+    CsrMatrix<int> matrix;
+    matrix.rows = rows;
+    matrix.cols = cols;
+    matrix.rowPtr.assign(rows + 1, 0);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            int value;
+            if (!parser.next(value)) {
+                throw ioError("Malformed matrix file", path);
+            }
+            if (value != 0) {
+                matrix.colIdx.push_back(j);
+                matrix.values.push_back(value);
+            }
+        }
+        matrix.rowPtr[i + 1] = matrix.nnz();
+    }
+    return matrix;
+}
+
+std::string lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+/*
+ * Parallel parser for files laid out one row per line (as every writer of the format
+ * does). The mapped file is cut into one byte range per thread on line boundaries;
+ * threads first count their lines to learn which row they start at, then parse their
+ * rows independently. Returns false, so that the caller can fall back to the serial
+ * parser, if the layout is not one row per line.
+ */
+bool parseTextParallel(const std::string& path, int threads, Matrix<int>& matrix) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw ioError("Error opening file", path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    const std::size_t length = st.st_size;
+    void* base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    madvise(base, length, MADV_WILLNEED);
+    const char* begin = static_cast<const char*>(base);
+    const char* end = begin + length;
+
+    // Header line: exactly "rows cols"
+    int rows, cols;
+    const char* p = skipSpaces(begin, end);
+    p = parseInt(p, end, rows);
+    p = p != nullptr ? parseInt(skipSpaces(p, end), end, cols) : nullptr;
+    const char* body = p != nullptr ? static_cast<const char*>(std::memchr(p, '\n', end - p)) : nullptr;
+    if (body == nullptr || skipSpaces(p, body) != body || rows < 0 || cols < 0) {
+        munmap(base, length);
+        return false;
+    }
+    ++body;
+
+    // Byte ranges starting right after a newline
+    std::vector<const char*> starts(threads + 1, end);
+    starts[0] = body;
+    for (int t = 1; t < threads; ++t) {
+        const char* guess = body + (end - body) * t / threads;
+        const char* nl = static_cast<const char*>(std::memchr(guess, '\n', end - guess));
+        starts[t] = nl != nullptr ? std::max(nl + 1, starts[t - 1]) : end;
+    }
+
+    std::vector<long long> firstRow(threads + 1, 0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            long long lines = 0;
+            for (const char* q = starts[t]; q < starts[t + 1]; ++lines) {
+                const char* nl = static_cast<const char*>(std::memchr(q, '\n', starts[t + 1] - q));
+                q = nl != nullptr ? nl + 1 : starts[t + 1];
+            }
+            firstRow[t + 1] = lines;
+        });
+    }
+    for (std::thread& w : workers) {
+        w.join();
+    }
+    workers.clear();
+    for (int t = 0; t < threads; ++t) {
+        firstRow[t + 1] += firstRow[t];
+    }
+    if (firstRow[threads] < rows) {
+        munmap(base, length);
+        return false;
+    }
+
+    matrix = Matrix<int>(rows, cols);
+    std::atomic<bool> regular{true};
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            long long row = firstRow[t];
+            for (const char* q = starts[t]; q < starts[t + 1] && row < rows && regular; ++row) {
+                const char* nl = static_cast<const char*>(std::memchr(q, '\n', starts[t + 1] - q));
+                const char* lineEnd = nl != nullptr ? nl : starts[t + 1];
+                int* out = matrix.row(static_cast<int>(row));
+                for (int j = 0; j < cols; ++j) {
+                    q = skipSpaces(q, lineEnd);
+                    q = q < lineEnd ? parseInt(q, lineEnd, out[j]) : nullptr;
+                    if (q == nullptr) {
+                        regular = false;
+                        return;
+                    }
+                }
+                if (skipSpaces(q, lineEnd) != lineEnd) {
+                    regular = false;
+                    return;
+                }
+                q = lineEnd + 1;
+            }
+        });
+    }
+    for (std::thread& w : workers) {
+        w.join();
+    }
+    munmap(base, length);
+    return regular;
+}
+
+// Accumulates formatted output in a large buffer and hands it to write() in blocks
+class BufferedWriter {
+public:
+    explicit BufferedWriter(int fd) : fd_(fd), buffer_(WRITE_CHUNK) {}
+    ~BufferedWriter() {
+        if (used_ > 0) {
+            writeAll();
+        }
+    }
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    // Integers in decimal, floating-point values in their shortest exact form
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, char>>>
+    void put(T value) {
+        reserve(32);
+        used_ = std::to_chars(buffer_.data() + used_, buffer_.data() + buffer_.size(), value).ptr - buffer_.data();
+    }
+
+    void put(char c) {
+        reserve(1);
+        buffer_[used_++] = c;
+    }
+
+    void put(const std::string& text) {
+        for (char c : text) {
+            put(c);
+        }
+    }
+
+    // Returns false if any write failed
+    bool flush() {
+        writeAll();
+        return ok_;
+    }
+
+private:
+    static constexpr std::size_t WRITE_CHUNK = 1 << 20;
+
+    void reserve(std::size_t bytes) {
+        if (used_ + bytes > buffer_.size()) {
+            writeAll();
+        }
+    }
+
+    void writeAll() {
+        const char* p = buffer_.data();
+        while (used_ > 0) {
+            ssize_t n = write(fd_, p, used_);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                ok_ = false;
+                break;
+            }
+            p += n;
+            used_ -= n;
+        }
+        used_ = 0;
+    }
+
+    int fd_;
+    std::vector<char> buffer_;
+    std::size_t used_ = 0;
+    bool ok_ = true;
+};
+
+} // namespace
+
+std::uint64_t checksumBytes(const void* data, std::size_t bytes, std::uint64_t seed) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    std::uint64_t hash = seed;
+    for (std::size_t i = 0; i < bytes; ++i) {
+        hash = (hash ^ p[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+Matrix<int> readMatrixText(const std::string& path, int threads) {
+    PROFILE_SCOPE(Region::Read);
+    if (threads > 1) {
+        Matrix<int> matrix;
+        if (parseTextParallel(path, threads, matrix)) {
+            return matrix;
+        }
+    }
+    return parseTextChunked(path);
+}
+
+const char* dtypeName(DType dtype) {
+    switch (dtype) {
+    case DType::Int8:
+        return "int8";
+    case DType::Int16:
+        return "int16";
+    case DType::Int32:
+        return "int32";
+    case DType::Int64:
+        return "int64";
+    case DType::Float32:
+        return "float32";
+    case DType::Float64:
+        return "float64";
+    }
+    return "unknown";
+}
+
+bool parseDType(const std::string& name, DType& dtype) {
+    for (DType candidate : {DType::Int8, DType::Int16, DType::Int32, DType::Int64, DType::Float32, DType::Float64}) {
+        if (name == dtypeName(candidate)) {
+            dtype = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::size_t dtypeSize(DType dtype) {
+    switch (dtype) {
+    case DType::Int8:
+        return 1;
+    case DType::Int16:
+        return 2;
+    case DType::Int32:
+    case DType::Float32:
+        return 4;
+    case DType::Int64:
+    case DType::Float64:
+        return 8;
+    }
+    return 0;
+}
+
+template <typename T>
+void writeMatrixText(const std::string& path, ConstMatrixView<T> matrix) {
+    PROFILE_SCOPE(Region::Write);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw ioError("Error opening file", path);
+    }
+    BufferedWriter out(fd);
+    out.put(matrix.rows());
+    out.put(' ');
+    out.put(matrix.cols());
+    out.put('\n');
+    for (int i = 0; i < matrix.rows(); ++i) {
+        const T* row = matrix.row(i);
+        for (int j = 0; j < matrix.cols(); ++j) {
+            if (j > 0) {
+                out.put(' ');
+            }
+            out.put(row[j]);
+        }
+        out.put('\n');
+    }
+    const bool ok = out.flush();
+    if (close(fd) != 0 || !ok) {
+        throw ioError("Error writing file", path);
+    }
+}
+
+template <typename T>
+void printMatrix(int fd, ConstMatrixView<T> matrix) {
+    PROFILE_SCOPE(Region::Write);
+    BufferedWriter out(fd);
+    for (int i = 0; i < matrix.rows(); ++i) {
+        const T* row = matrix.row(i);
+        for (int j = 0; j < matrix.cols(); ++j) {
+            out.put(row[j]);
+            out.put(' ');
+        }
+        out.put('\n');
+    }
+    if (!out.flush()) {
+        throw std::runtime_error("Error writing matrix to descriptor " + std::to_string(fd));
+    }
+}
+
+CsrMatrix<int> readMatrixTextSparse(const std::string& path) {
+    PROFILE_SCOPE(Region::Read);
+    return parseTextSparse(path);
+}
+
+bool isMatrixMarketFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char banner[sizeof(MATRIX_MARKET_BANNER) - 1];
+    return in.read(banner, sizeof(banner)) && std::memcmp(banner, MATRIX_MARKET_BANNER, sizeof(banner)) == 0;
+}
+
+CsrMatrix<int> readMatrixMarket(const std::string& path) {
+    PROFILE_SCOPE(Region::Read);
+    std::ifstream in(path);
+    if (!in) {
+        throw ioError("Error opening file", path);
+    }
+    std::string line;
+    std::getline(in, line);
+    std::istringstream banner(line);
+    std::string tag, object, format, field, symmetry;
+    banner >> tag >> object >> format >> field >> symmetry;
+    object = lowercase(object);
+    format = lowercase(format);
+    field = lowercase(field);
+    symmetry = lowercase(symmetry);
+    if (tag != MATRIX_MARKET_BANNER || object != "matrix" || format != "coordinate") {
+        throw ioError("Not a Matrix Market coordinate file", path);
+    }
+    if (field != "integer" && field != "pattern") {
+        throw ioError("Unsupported Matrix Market field " + field, path);
+    }
+    if (symmetry != "general" && symmetry != "symmetric" && symmetry != "skew-symmetric") {
+        throw ioError("Unsupported Matrix Market symmetry " + symmetry, path);
+    }
+
+    // Comment lines, then "rows cols entries"
+    long long rows = -1, cols = -1, entries = -1;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '%') {
+            continue;
+        }
+        std::istringstream size(line);
+        size >> rows >> cols >> entries;
+        break;
+    }
+    if (rows < 0 || cols < 0 || entries < 0 || rows > INT32_MAX || cols > INT32_MAX || entries > INT32_MAX) {
+        throw ioError("Malformed Matrix Market size line", path);
+    }
+    const off_t offset = in.tellg();
+    if (offset < 0) {
+        throw ioError("Malformed Matrix Market size line", path);
+    }
+
+    // Entries "i j [value]" with 1-based indices; symmetric files list only one triangle
+    const bool pattern = field == "pattern";
+    const bool mirrored = symmetry != "general";
+    const int sign = symmetry == "skew-symmetric" ? -1 : 1;
+    std::vector<int> rowIndex, colIndex, values;
+    rowIndex.reserve(entries);
+    colIndex.reserve(entries);
+    values.reserve(entries);
+    ChunkedTextParser parser(path, offset);
+    for (long long e = 0; e < entries; ++e) {
+        int i, j, value = 1;
+        if (!parser.next(i) || !parser.next(j) || (!pattern && !parser.next(value))) {
+            throw ioError("Truncated Matrix Market file", path);
+        }
+        if (i < 1 || i > rows || j < 1 || j > cols) {
+            throw ioError("Matrix Market index out of range", path);
+        }
+        rowIndex.push_back(i - 1);
+        colIndex.push_back(j - 1);
+        values.push_back(value);
+        if (mirrored && i != j) {
+            rowIndex.push_back(j - 1);
+            colIndex.push_back(i - 1);
+            values.push_back(sign * value);
+        }
+    }
+    return csrFromTriplets(static_cast<int>(rows), static_cast<int>(cols), rowIndex, colIndex, values);
+}
+
+bool isBinaryMatrixFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(MAGIC)];
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+MatrixFileHeader readMatrixHeader(const std::string& path) {
+    PROFILE_SCOPE(Region::Read);
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw ioError("Error opening file", path);
+    }
+    MatrixFileHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        throw ioError("Truncated binary matrix header", path);
+    }
+    checkHeader(header, path);
+    return header;
+}
+
+void verifyMatrixFile(const std::string& path) {
+    PROFILE_SCOPE(Region::Read);
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw ioError("Error opening file", path);
+    }
+    MatrixFileHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        throw ioError("Truncated binary matrix header", path);
+    }
+    checkHeader(header, path);
+
+    std::uint64_t remaining = static_cast<std::uint64_t>(header.rows) * header.cols * dtypeSize(header.dtype);
+    std::uint64_t checksum = checksumBytes(nullptr, 0);
+    std::vector<char> block(std::size_t(1) << 20);
+    while (remaining > 0) {
+        const std::size_t bytes = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, block.size()));
+        if (!in.read(block.data(), bytes)) {
+            throw ioError("Truncated binary matrix file", path);
+        }
+        checksum = checksumBytes(block.data(), bytes, checksum);
+        remaining -= bytes;
+    }
+    if (!(header.flags & MATRIX_FILE_NO_CHECKSUM) && checksum != header.checksum) {
+        throw ioError("Checksum mismatch in binary matrix file", path);
+    }
+}
+
+MatrixFileHeader makeMatrixHeader(int rows, int cols, DType dtype) {
+    MatrixFileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = MATRIX_FILE_VERSION;
+    header.dtype = dtype;
+    header.layout = Layout::RowMajor;
+    header.rows = rows;
+    header.cols = cols;
+    header.checksum = checksumBytes(nullptr, 0);
+    return header;
+}
+
+template <typename T>
+void writeMatrixBinary(const std::string& path, ConstMatrixView<T> matrix) {
+    PROFILE_SCOPE(Region::Write);
+    MatrixFileHeader header = makeMatrixHeader(matrix.rows(), matrix.cols(), dtypeOf<T>());
+    for (int i = 0; i < matrix.rows(); ++i) {
+        header.checksum = checksumBytes(matrix.row(i), matrix.cols() * sizeof(T), header.checksum);
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw ioError("Error opening file", path);
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (int i = 0; i < matrix.rows(); ++i) {
+        out.write(reinterpret_cast<const char*>(matrix.row(i)), matrix.cols() * sizeof(T));
+    }
+    if (!out) {
+        throw ioError("Error writing file", path);
+    }
+}
+
+template <typename T>
+Matrix<T> mapMatrixBinary(const std::string& path, bool verify) {
+    PROFILE_SCOPE(Region::Read);
+    MatrixFileHeader header = readMatrixHeader(path);
+    if (header.dtype != dtypeOf<T>()) {
+        throw ioError(std::string("Expected a binary matrix of ") + dtypeName(dtypeOf<T>()) + ", found " +
+                          dtypeName(header.dtype),
+                      path);
+    }
+    const std::size_t payload = static_cast<std::size_t>(header.rows) * header.cols * sizeof(T);
+    const std::size_t length = sizeof(header) + payload;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw ioError("Error opening file", path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < length) {
+        close(fd);
+        throw ioError("Truncated binary matrix file", path);
+    }
+    void* base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        throw ioError("Error mapping file", path);
+    }
+    madvise(base, length, MADV_SEQUENTIAL);
+
+    T* data = reinterpret_cast<T*>(static_cast<char*>(base) + sizeof(header));
+    if (verify && !(header.flags & MATRIX_FILE_NO_CHECKSUM) && checksumBytes(data, payload) != header.checksum) {
+        munmap(base, length);
+        throw ioError("Checksum mismatch in binary matrix file", path);
+    }
+
+    const int rows = static_cast<int>(header.rows);
+    const int cols = static_cast<int>(header.cols);
+    return Matrix<T>::adopt(data, rows, cols, cols, [base, length] { munmap(base, length); });
+}
+
+Matrix<int> readMatrix(const std::string& path, bool verify, int threads) {
+    PROFILE_SCOPE(Region::Read);
+    return isBinaryMatrixFile(path) ? mapMatrixBinary(path, verify) : readMatrixText(path, threads);
+}
+
+#define INSTANTIATE_MATRIX_IO(T)                                                                                      \
+    template void writeMatrixText<T>(const std::string&, ConstMatrixView<T>);                                         \
+    template void printMatrix<T>(int, ConstMatrixView<T>);                                                            \
+    template void writeMatrixBinary<T>(const std::string&, ConstMatrixView<T>);                                       \
+    template Matrix<T> mapMatrixBinary<T>(const std::string&, bool);
+
+INSTANTIATE_MATRIX_IO(std::int8_t)
+INSTANTIATE_MATRIX_IO(std::int16_t)
+INSTANTIATE_MATRIX_IO(std::int32_t)
+INSTANTIATE_MATRIX_IO(std::int64_t)
+INSTANTIATE_MATRIX_IO(float)
+INSTANTIATE_MATRIX_IO(double)
+
+#undef INSTANTIATE_MATRIX_IO
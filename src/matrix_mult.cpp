@@ -1,17 +1,172 @@
-#include <vector>
+#include "matrix_multiplication.h"
+#include "profile.h"
+#include "thread_pool.h"
 #include <algorithm>
-#include <iostream>
-
-void multiplyMatricesWithoutErrors(const std::vector<std::vector<int>> &A,
-                      const std::vector<std::vector<int>> &B,
-                      std::vector<std::vector<int>> &C, int rowsA, int colsA,
-                      int colsB) {
-  for (int i = 0; i < rowsA; ++i) {
-    for (int j = 0; j < colsB; ++j) {
-      C[i][j] = 0;
-      for (int k = 0; k < colsA; ++k) {
-        C[i][j] += A[i][k] * B[k][j];
-      }
-    }
-  }
-}
\ No newline at end of file
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+template <typename T, typename Acc>
+void checkDimensions(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C) {
+    if (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols()) {
+        throw std::invalid_argument("multiplyMatrices: incompatible matrix dimensions");
+    }
+}
+
+// Elements of a row of C per task of the vector-matrix product: 8 KB of Acc, which stay in
+// L1 while the rows of B stream past them
+template <typename Acc>
+constexpr int VECTOR_CHUNK = 8192 / sizeof(Acc);
+
+// Rows of A per task of the matrix-vector product (a multiple of the 4 rows the kernel takes at once)
+constexpr int GEMV_CHUNK = 64;
+
+/*
+ * C += A * B (C = A * B with overwrite) for the shapes with a vector in them, where the
+ * block kernel would reload a one-element-wide tile of C for every element of A:
+ *  - cols(B) == 1: matrix-vector product (GEMV), one dot product per row of A
+ *  - rows(A) == 1: vector-matrix product (GEVM), the rows of B scaled and summed into C
+ *  - cols(A) == 1: rank-1 outer product, every row of C a scaled copy of the row B
+ * Returns false for the other shapes.
+ */
+template <typename T, typename Acc>
+bool multiplyVectorShape(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C, bool overwrite) {
+    const int M = A.rows();
+    const int K = A.cols();
+    const int N = B.cols();
+    ThreadPool& pool = ThreadPool::global();
+    if (overwrite && (N == 1 || M == 1)) {
+        // Only one row or column of C: clearing it first is cheap
+        for (int i = 0; i < M; ++i) {
+            std::fill_n(C.row(i), N, Acc());
+        }
+    }
+
+    if (N == 1) {
+        const GemvKernelOf<T, Acc> gemv = gemvKernelFor<T, Acc>(activeIsa());
+        std::vector<Acc> x(K);
+        for (int k = 0; k < K; ++k) {
+            x[k] = static_cast<Acc>(B(k, 0));
+        }
+        pool.parallelFor((M + GEMV_CHUNK - 1) / GEMV_CHUNK, [&](int chunk) {
+            const int i = chunk * GEMV_CHUNK;
+            gemv(A.row(i), A.stride(), x.data(), C.row(i), C.stride(), std::min(GEMV_CHUNK, M - i), K);
+        });
+        return true;
+    }
+    if (M == 1) {
+        const AxpyKernelOf<T, Acc> axpy = axpyKernelFor<T, Acc>(activeIsa());
+        pool.parallelFor((N + VECTOR_CHUNK<Acc> - 1) / VECTOR_CHUNK<Acc>, [&](int chunk) {
+            const int j = chunk * VECTOR_CHUNK<Acc>;
+            const int nb = std::min(VECTOR_CHUNK<Acc>, N - j);
+            for (int k = 0; k < K; ++k) {
+                axpy(static_cast<Acc>(A(0, k)), B.row(k) + j, C.row(0) + j, nb, false);
+            }
+        });
+        return true;
+    }
+    if (K == 1) {
+        const AxpyKernelOf<T, Acc> axpy = axpyKernelFor<T, Acc>(activeIsa());
+        pool.parallelFor(M, [&](int i) { axpy(static_cast<Acc>(A(i, 0)), B.row(0), C.row(i), N, overwrite); });
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+template <typename T, typename Acc>
+void multiplyAccumulateBlocked(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C, const TileSizes& tiles) {
+    PROFILE_SCOPE(Region::Multiply, 2.0 * A.rows() * A.cols() * B.cols());
+    checkDimensions(A, B, C);
+    if (C.empty() || multiplyVectorShape(A, B, C, false)) {
+        return;
+    }
+
+    const int M = A.rows();
+    const int K = A.cols();
+    const int N = B.cols();
+    const BlockKernelOf<T, Acc> kernel = blockKernelFor<T, Acc>(activeIsa());
+    ThreadPool& pool = ThreadPool::global();
+
+    // C is cut into (mb x nc) tiles that the pool threads share out. With more than one
+    // thread, tiles are kept short enough for every thread to get a few of them.
+    int mb = tiles.mc;
+    if (pool.size() > 1) {
+        const int rowsPerThread = (M + 4 * pool.size() - 1) / (4 * pool.size());
+        mb = std::max(4, std::min(mb, (rowsPerThread + 3) / 4 * 4));
+    }
+    const int rowTiles = (M + mb - 1) / mb;
+    const int colTiles = (N + tiles.nc - 1) / tiles.nc;
+
+    pool.parallelFor(rowTiles * colTiles, [&](int tile) {
+        TILE_SCOPE();
+        const int ic = (tile % rowTiles) * mb;
+        const int jc = (tile / rowTiles) * tiles.nc;
+        const int rows = std::min(mb, M - ic);
+        const int nb = std::min(tiles.nc, N - jc);
+        // The (kc x nc) block of B stays in L2 while the rows of the tile stream past it;
+        // the block kernel walks B and C along rows (i-k-j), with both segments in L1
+        for (int pc = 0; pc < K; pc += tiles.kc) {
+            const int kb = std::min(tiles.kc, K - pc);
+            kernel(A.row(ic) + pc, A.stride(), B.row(pc) + jc, B.stride(), C.row(ic) + jc, C.stride(), rows, nb, kb);
+        }
+    });
+}
+
+template <typename T, typename Acc>
+void multiplyMatricesBlocked(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C, const TileSizes& tiles) {
+    PROFILE_SCOPE(Region::Multiply, 2.0 * A.rows() * A.cols() * B.cols());
+    checkDimensions(A, B, C);
+    if (!C.empty() && multiplyVectorShape(A, B, C, true)) {
+        return;
+    }
+    for (int i = 0; i < C.rows(); ++i) {
+        std::fill_n(C.row(i), C.cols(), Acc());
+    }
+    multiplyAccumulateBlocked(A, B, C, tiles);
+}
+
+template <typename T, typename Acc>
+void multiplyMatrices(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C) {
+    multiplyMatricesBlocked(A, B, C, tileSizes());
+}
+
+template <typename T, typename Acc>
+void multiplyAccumulate(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C) {
+    multiplyAccumulateBlocked(A, B, C, tileSizes());
+}
+
+// One instantiation of every entry point per (element, accumulator) pair of the header
+#define INSTANTIATE_MULTIPLY(T, Acc)                                                                                 \
+    template void multiplyMatrices<T, Acc>(ConstMatrixView<T>, ConstMatrixView<T>, MatrixView<Acc>);                 \
+    template void multiplyAccumulate<T, Acc>(ConstMatrixView<T>, ConstMatrixView<T>, MatrixView<Acc>);               \
+    template void multiplyMatricesBlocked<T, Acc>(ConstMatrixView<T>, ConstMatrixView<T>, MatrixView<Acc>,           \
+                                                  const TileSizes&);                                                 \
+    template void multiplyAccumulateBlocked<T, Acc>(ConstMatrixView<T>, ConstMatrixView<T>, MatrixView<Acc>,         \
+                                                    const TileSizes&);
+
+INSTANTIATE_MULTIPLY(std::int8_t, std::int32_t)
+INSTANTIATE_MULTIPLY(std::int8_t, std::int64_t)
+INSTANTIATE_MULTIPLY(std::int16_t, std::int32_t)
+INSTANTIATE_MULTIPLY(std::int16_t, std::int64_t)
+INSTANTIATE_MULTIPLY(std::int32_t, std::int32_t)
+INSTANTIATE_MULTIPLY(std::int32_t, std::int64_t)
+INSTANTIATE_MULTIPLY(std::int64_t, std::int64_t)
+INSTANTIATE_MULTIPLY(float, float)
+INSTANTIATE_MULTIPLY(float, double)
+INSTANTIATE_MULTIPLY(double, double)
+
+#undef INSTANTIATE_MULTIPLY
+
+void multiplyMatrices(const std::vector<std::vector<int>>& A, const std::vector<std::vector<int>>& B,
+                      std::vector<std::vector<int>>& C, int rowsA, int colsA, int colsB) {
+    Matrix<int> a = Matrix<int>::fromNested(A, rowsA, colsA);
+    Matrix<int> b = Matrix<int>::fromNested(B, colsA, colsB);
+    Matrix<int> c(rowsA, colsB);
+
+    multiplyMatrices(a, b, c);
+    c.copyToNested(C);
+}
@@ -0,0 +1,180 @@
+#include "parallel_io.h"
+#include "matrix_io.h"
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+
+// Reads `count` items of `memtype` into `buffer` through a view of the payload of `path`,
+// whose elements are of type `element`. The file must hold a payload of `payload` bytes: a
+// read past its end would leave the missing elements as they were without an error.
+void readViewAll(const std::string& path, std::uint64_t payload, MPI_Datatype element, MPI_Datatype filetype, void* buffer,
+                 int count, MPI_Datatype memtype, MPI_Comm comm) {
+    PROFILE_SCOPE(Region::Read);
+    MPI_File file;
+    if (MPI_File_open(comm, path.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+        throw std::runtime_error("Error opening file: " + path);
+    }
+    // Every rank sees the same size, so all of them skip the collective read together
+    MPI_Offset size = 0;
+    if (MPI_File_get_size(file, &size) == MPI_SUCCESS &&
+        static_cast<std::uint64_t>(size) < sizeof(MatrixFileHeader) + payload) {
+        MPI_File_close(&file);
+        throw std::runtime_error("Truncated binary matrix file: " + path);
+    }
+    char native[] = "native";
+    int status = MPI_File_set_view(file, sizeof(MatrixFileHeader), element, filetype, native, MPI_INFO_NULL);
+    if (status == MPI_SUCCESS) {
+        status = MPI_File_read_at_all(file, 0, buffer, count, memtype, MPI_STATUS_IGNORE);
+    }
+    MPI_File_close(&file);
+    if (status != MPI_SUCCESS) {
+        throw std::runtime_error("Error reading file: " + path);
+    }
+}
+
+template <typename T>
+std::uint64_t payloadBytes(int rows, int cols) {
+    return static_cast<std::uint64_t>(rows) * cols * sizeof(T);
+}
+
+// Creates `path` holding a header written by rank 0 and, after it, the payload written
+// collectively through `filetype`
+void writeViewAll(const std::string& path, int rows, int cols, DType dtype, MPI_Datatype element, MPI_Datatype filetype, const void* buffer, int count,
+                  MPI_Datatype memtype, MPI_Comm comm) {
+    PROFILE_SCOPE(Region::Write);
+    MPI_File file;
+    if (MPI_File_open(comm, path.c_str(), MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+        throw std::runtime_error("Error opening file: " + path);
+    }
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    int status = MPI_File_set_size(file, 0);
+    if (status == MPI_SUCCESS && rank == 0) {
+        MatrixFileHeader header = makeMatrixHeader(rows, cols, dtype);
+        header.flags |= MATRIX_FILE_NO_CHECKSUM;
+        status = MPI_File_write_at(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+    // The header is written by rank 0 alone: the ranks agree on whether it and the truncation
+    // succeeded, so that all of them either enter the collectives below or skip them together
+    int failed = status != MPI_SUCCESS;
+    MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, comm);
+    status = failed ? MPI_ERR_IO : MPI_SUCCESS;
+    char native[] = "native";
+    if (status == MPI_SUCCESS) {
+        status = MPI_File_set_view(file, sizeof(MatrixFileHeader), element, filetype, native, MPI_INFO_NULL);
+    }
+    if (status == MPI_SUCCESS) {
+        status = MPI_File_write_at_all(file, 0, buffer, count, memtype, MPI_STATUS_IGNORE);
+    }
+    MPI_File_close(&file);
+    if (status != MPI_SUCCESS) {
+        throw std::runtime_error("Error writing file: " + path);
+    }
+}
+
+void freeType(MPI_Datatype& type, MPI_Datatype element) {
+    if (type != element) {
+        MPI_Type_free(&type);
+    }
+}
+
+// Darray datatype of the local part of this rank, or `element` itself for an empty matrix
+MPI_Datatype blockCyclicFileType(const BlockCyclicLayout& layout, const ProcessGrid& grid, MPI_Datatype element) {
+    int rank;
+    MPI_Comm_rank(grid.comm, &rank);
+    return layout.rows == 0 || layout.cols == 0 ? element : blockCyclicType(layout, grid, rank, element);
+}
+
+} // namespace
+
+template <typename T>
+Matrix<T> readRowBlockAll(const std::string& path, int rows, int cols, const RowPartition& partition, MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    Matrix<T> local(partition.counts[rank], cols);
+    RowType<T> row(cols);
+    MPI_Datatype filetype = rowBlockType(rows, cols, partition, rank, mpiType<T>());
+    try {
+        readViewAll(path, payloadBytes<T>(rows, cols), mpiType<T>(), filetype, local.data(), local.rows(), row, comm);
+    } catch (...) {
+        freeType(filetype, mpiType<T>());
+        throw;
+    }
+    freeType(filetype, mpiType<T>());
+    return local;
+}
+
+template <typename T>
+void writeRowBlockAll(const std::string& path, const Matrix<T>& local, int rows, const RowPartition& partition,
+                      MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    RowType<T> row(local.cols());
+    MPI_Datatype filetype = rowBlockType(rows, local.cols(), partition, rank, mpiType<T>());
+    try {
+        writeViewAll(path, rows, local.cols(), dtypeOf<T>(), mpiType<T>(), filetype, local.data(), local.rows(), row, comm);
+    } catch (...) {
+        freeType(filetype, mpiType<T>());
+        throw;
+    }
+    freeType(filetype, mpiType<T>());
+}
+
+template <typename T>
+Matrix<T> readMatrixAll(const std::string& path, int rows, int cols, MPI_Comm comm) {
+    Matrix<T> matrix(rows, cols);
+    RowType<T> row(cols);
+    readViewAll(path, payloadBytes<T>(rows, cols), mpiType<T>(), mpiType<T>(), matrix.data(), rows, row, comm);
+    return matrix;
+}
+
+template <typename T>
+Matrix<T> readBlockCyclicAll(const std::string& path, const BlockCyclicLayout& layout, const ProcessGrid& grid) {
+    Matrix<T> local(layout.localRows(grid), layout.localCols(grid));
+    RowType<T> row(local.cols());
+    MPI_Datatype filetype = blockCyclicFileType(layout, grid, mpiType<T>());
+    try {
+        readViewAll(path, payloadBytes<T>(layout.rows, layout.cols), mpiType<T>(), filetype, local.data(), local.rows(), row,
+                    grid.comm);
+    } catch (...) {
+        freeType(filetype, mpiType<T>());
+        throw;
+    }
+    freeType(filetype, mpiType<T>());
+    return local;
+}
+
+template <typename T>
+void writeBlockCyclicAll(const std::string& path, const Matrix<T>& local, const BlockCyclicLayout& layout,
+                         const ProcessGrid& grid) {
+    RowType<T> row(local.cols());
+    MPI_Datatype filetype = blockCyclicFileType(layout, grid, mpiType<T>());
+    try {
+        writeViewAll(path, layout.rows, layout.cols, dtypeOf<T>(), mpiType<T>(), filetype, local.data(), local.rows(), row, grid.comm);
+    } catch (...) {
+        freeType(filetype, mpiType<T>());
+        throw;
+    }
+    freeType(filetype, mpiType<T>());
+}
+
+#define INSTANTIATE_PARALLEL_IO(T)                                                                                    \
+    template Matrix<T> readRowBlockAll<T>(const std::string&, int, int, const RowPartition&, MPI_Comm);              \
+    template Matrix<T> readMatrixAll<T>(const std::string&, int, int, MPI_Comm);                                      \
+    template Matrix<T> readBlockCyclicAll<T>(const std::string&, const BlockCyclicLayout&, const ProcessGrid&);       \
+    template void writeRowBlockAll<T>(const std::string&, const Matrix<T>&, int, const RowPartition&, MPI_Comm);      \
+    template void writeBlockCyclicAll<T>(const std::string&, const Matrix<T>&, const BlockCyclicLayout&,              \
+                                         const ProcessGrid&);
+
+INSTANTIATE_PARALLEL_IO(std::int8_t)
+INSTANTIATE_PARALLEL_IO(std::int16_t)
+INSTANTIATE_PARALLEL_IO(std::int32_t)
+INSTANTIATE_PARALLEL_IO(std::int64_t)
+INSTANTIATE_PARALLEL_IO(float)
+INSTANTIATE_PARALLEL_IO(double)
+
+#undef INSTANTIATE_PARALLEL_IO
@@ -0,0 +1,131 @@
+#include "pipeline.h"
+#include "matrix_multiplication.h"
+#include "structure.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// Rows of A multiplied between two tests of the outstanding transfers
+constexpr int PIPELINE_ROW_CHUNK = 128;
+
+// Lets MPI move the outstanding transfers along; completed requests become MPI_REQUEST_NULL
+void progress(std::vector<MPI_Request>& requests) {
+    if (!requests.empty()) {
+        int done;
+        MPI_Testall(static_cast<int>(requests.size()), requests.data(), &done, MPI_STATUSES_IGNORE);
+    }
+}
+
+} // namespace
+
+int pipelinePanelWidth(int cols) {
+    return std::max(64, ((cols + 7) / 8 + 63) / 64 * 64);
+}
+
+template <typename T, typename Acc>
+double multiplyPipelined(ConstMatrixView<T> localA, ConstMatrixView<T> B, MatrixView<Acc> localC, Matrix<Acc>& C,
+                         const RowPartition& rows, int panelWidth, bool broadcastB, bool gather, bool structure,
+                         int root, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    const int K = B.rows();
+    const int N = B.cols();
+    const int local = localC.rows();
+    const int panels = (N + panelWidth - 1) / panelWidth;
+    auto widthOf = [&](int k) { return std::min(panelWidth, N - k * panelWidth); };
+
+    double waited = 0.0;
+    auto wait = [&](int count, MPI_Request* requests) {
+        PROFILE_SCOPE(Region::Wait);
+        const double start = MPI_Wtime();
+        MPI_Waitall(count, requests, MPI_STATUSES_IGNORE);
+        waited += MPI_Wtime() - start;
+    };
+
+    // Panel k of B on every rank. The buffer is written on the non-root ranks only
+    std::vector<MPI_Request> panelsB(panels, MPI_REQUEST_NULL);
+    auto postPanel = [&](int k) {
+        BlockType<T> panel(K, widthOf(k), B.stride());
+        MPI_Ibcast(const_cast<T*>(B.data()) + k * panelWidth, 1, panel, root, comm, &panelsB[k]);
+    };
+
+    // Blocks of C in flight: root receives every block of every other rank up front
+    std::vector<MPI_Request> blocksC;
+    if (gather && rank == root) {
+        for (int k = 0; k < panels; ++k) {
+            for (int r = 0; r < size; ++r) {
+                if (r == root || rows.counts[r] == 0) {
+                    continue;
+                }
+                BlockType<Acc> block(rows.counts[r], widthOf(k), C.stride());
+                blocksC.emplace_back();
+                MPI_Irecv(C.row(rows.offsets[r]) + k * panelWidth, 1, block, r, k, comm, &blocksC.back());
+            }
+        }
+    }
+
+    if (broadcastB && panels > 0) {
+        postPanel(0);
+    }
+    for (int k = 0; k < panels; ++k) {
+        const int j = k * panelWidth;
+        const int width = widthOf(k);
+        if (broadcastB) {
+            if (k + 1 < panels) {
+                postPanel(k + 1);
+            }
+            wait(1, &panelsB[k]);
+        }
+
+        ConstMatrixView<T> panelB = B.block(0, j, K, width);
+        for (int i = 0; i < local; i += PIPELINE_ROW_CHUNK) {
+            const int chunk = std::min(PIPELINE_ROW_CHUNK, local - i);
+            ConstMatrixView<T> chunkA = localA.rowBlock(i, chunk);
+            MatrixView<Acc> blockC = localC.block(i, j, chunk, width);
+            // The chunk holds rows from rows.offsets[rank] + i of the full A
+            if (!structure || !multiplyStructured<T, Acc>(chunkA, panelB, blockC, rows.offsets[rank] + i)) {
+                multiplyMatrices<T, Acc>(chunkA, panelB, blockC);
+            }
+            if (broadcastB && k + 1 < panels) {
+                progress(panelsB);
+            }
+            progress(blocksC);
+        }
+
+        if (!gather || local == 0) {
+            continue;
+        }
+        if (rank == root) {
+            for (int i = 0; i < local; ++i) {
+                std::copy_n(localC.row(i) + j, width, C.row(rows.offsets[rank] + i) + j);
+            }
+        } else {
+            BlockType<Acc> block(local, width, localC.stride());
+            blocksC.emplace_back();
+            MPI_Isend(localC.row(0) + j, 1, block, root, k, comm, &blocksC.back());
+        }
+    }
+    wait(static_cast<int>(blocksC.size()), blocksC.data());
+    return waited;
+}
+
+#define INSTANTIATE_PIPELINE(T, Acc)                                                                                  \
+    template double multiplyPipelined<T, Acc>(ConstMatrixView<T>, ConstMatrixView<T>, MatrixView<Acc>, Matrix<Acc>&, \
+                                              const RowPartition&, int, bool, bool, bool, int, MPI_Comm);
+
+INSTANTIATE_PIPELINE(std::int8_t, std::int32_t)
+INSTANTIATE_PIPELINE(std::int8_t, std::int64_t)
+INSTANTIATE_PIPELINE(std::int16_t, std::int32_t)
+INSTANTIATE_PIPELINE(std::int16_t, std::int64_t)
+INSTANTIATE_PIPELINE(std::int32_t, std::int32_t)
+INSTANTIATE_PIPELINE(std::int32_t, std::int64_t)
+INSTANTIATE_PIPELINE(std::int64_t, std::int64_t)
+INSTANTIATE_PIPELINE(float, float)
+INSTANTIATE_PIPELINE(float, double)
+INSTANTIATE_PIPELINE(double, double)
+
+#undef INSTANTIATE_PIPELINE
@@ -0,0 +1,429 @@
+#include "profile.h"
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* const REGION_NAMES[REGION_COUNT] = {"read",   "write",     "scatter", "broadcast",
+                                                "gather", "allgather", "wait",    "multiply"};
+// Chrome trace category of every event name, the regions then TRACE_TILE
+const char* const TRACE_CATEGORIES[REGION_COUNT + 1] = {"io",  "io",  "mpi",     "mpi",    "mpi",
+                                                        "mpi", "mpi", "compute", "compute"};
+// Round trips of the clock offset measurement between root and each rank
+constexpr int TRACE_CLOCK_ROUNDS = 8;
+const char* const COUNTER_NAMES[COUNTER_COUNT] = {"cycles", "instructions", "llc_misses"};
+const std::uint64_t COUNTER_EVENTS[COUNTER_COUNT] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                     PERF_COUNT_HW_CACHE_MISSES};
+
+struct Profile {
+    std::atomic<bool> enabled{false};
+    std::mutex mutex; // guards regions
+    RegionProfile regions[REGION_COUNT];
+    int fds[COUNTER_COUNT] = {-1, -1, -1};
+    std::thread::id counterThread; // the thread the counters measure
+
+    std::atomic<bool> tracing{false};
+    std::mutex traceMutex; // guards events and dropped
+    std::vector<TraceEvent> events;
+    std::size_t dropped = 0;
+    std::atomic<int> threads{1}; // trace thread numbers handed out
+};
+
+Profile& profile() {
+    static Profile p;
+    return p;
+}
+
+// Open scopes of each region on this thread
+thread_local int depth[REGION_COUNT];
+// Number of this thread in the trace, -1 until its first event
+thread_local int traceThread = -1;
+
+double steadySeconds(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration<double>(t.time_since_epoch()).count();
+}
+
+void record(Profile& p, int name, std::chrono::steady_clock::time_point begin,
+            std::chrono::steady_clock::time_point end) {
+    if (traceThread < 0) {
+        traceThread = p.threads++;
+    }
+    std::lock_guard<std::mutex> lock(p.traceMutex);
+    if (p.events.size() < TRACE_MAX_EVENTS) {
+        p.events.push_back(TraceEvent{name, traceThread, steadySeconds(begin), steadySeconds(end)});
+    } else {
+        ++p.dropped;
+    }
+}
+
+void closeCounters(Profile& p) {
+    for (int& fd : p.fds) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+}
+
+// User space counts of the calling thread, running from now on
+bool openCounters(Profile& p) {
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = COUNTER_EVENTS[c];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        p.fds[c] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (p.fds[c] < 0) {
+            closeCounters(p);
+            return false;
+        }
+    }
+    p.counterThread = std::this_thread::get_id();
+    return true;
+}
+
+bool readCounters(const Profile& p, std::uint64_t* values) {
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        if (read(p.fds[c], &values[c], sizeof(values[c])) != sizeof(values[c])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+const char* regionName(Region region) {
+    return REGION_NAMES[static_cast<int>(region)];
+}
+
+const char* counterName(int counter) {
+    return COUNTER_NAMES[counter];
+}
+
+bool setProfiling(bool enabled, bool counters) {
+    Profile& p = profile();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    closeCounters(p);
+    std::fill(std::begin(p.regions), std::end(p.regions), RegionProfile());
+    const bool opened = !enabled || !counters || openCounters(p);
+    p.enabled = enabled;
+    return opened;
+}
+
+bool profilingEnabled() {
+    return profile().enabled;
+}
+
+bool profilingCounters() {
+    Profile& p = profile();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    return p.fds[0] >= 0;
+}
+
+RegionProfile regionProfile(Region region) {
+    Profile& p = profile();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    return p.regions[static_cast<int>(region)];
+}
+
+void setTracing(bool enabled) {
+    Profile& p = profile();
+    std::lock_guard<std::mutex> lock(p.traceMutex);
+    p.events.clear();
+    p.events.shrink_to_fit();
+    p.dropped = 0;
+    traceThread = 0;
+    p.tracing = enabled;
+}
+
+bool tracingEnabled() {
+    return profile().tracing;
+}
+
+std::vector<TraceEvent> traceEvents() {
+    Profile& p = profile();
+    std::lock_guard<std::mutex> lock(p.traceMutex);
+    return p.events;
+}
+
+std::size_t droppedTraceEvents() {
+    Profile& p = profile();
+    std::lock_guard<std::mutex> lock(p.traceMutex);
+    return p.dropped;
+}
+
+ProfileScope::ProfileScope(Region region, double operations) : region_(region), operations_(operations) {
+    Profile& p = profile();
+    profiling_ = p.enabled.load(std::memory_order_relaxed);
+    tracing_ = p.tracing.load(std::memory_order_relaxed);
+    if (!profiling_ && !tracing_) {
+        return;
+    }
+    active_ = true;
+    outermost_ = depth[static_cast<int>(region)]++ == 0;
+    if (!outermost_) {
+        return; // nested: the outermost scope counts
+    }
+    counting_ = profiling_ && p.fds[0] >= 0 && std::this_thread::get_id() == p.counterThread &&
+                readCounters(p, counters_);
+    start_ = std::chrono::steady_clock::now();
+}
+
+ProfileScope::~ProfileScope() {
+    if (!active_) {
+        return;
+    }
+    --depth[static_cast<int>(region_)];
+    if (!outermost_) {
+        return;
+    }
+    const auto end = std::chrono::steady_clock::now();
+    Profile& p = profile();
+    std::uint64_t counters[COUNTER_COUNT];
+    const bool counted = counting_ && readCounters(p, counters);
+    if (tracing_) {
+        record(p, static_cast<int>(region_), start_, end);
+    }
+    if (!profiling_) {
+        return;
+    }
+    const double seconds = std::chrono::duration<double>(end - start_).count();
+
+    std::lock_guard<std::mutex> lock(p.mutex);
+    RegionProfile& stats = p.regions[static_cast<int>(region_)];
+    ++stats.calls;
+    stats.seconds += seconds;
+    stats.operations += operations_;
+    if (counted) {
+        for (int c = 0; c < COUNTER_COUNT; ++c) {
+            stats.counters[c] += counters[c] - counters_[c];
+        }
+    }
+}
+
+TileScope::TileScope() : tracing_(profile().tracing.load(std::memory_order_relaxed)) {
+    if (tracing_) {
+        start_ = std::chrono::steady_clock::now();
+    }
+}
+
+TileScope::~TileScope() {
+    if (tracing_) {
+        record(profile(), TRACE_TILE, start_, std::chrono::steady_clock::now());
+    }
+}
+
+ProfileSummary reduceProfile(int root, MPI_Comm comm) {
+    std::uint64_t calls[REGION_COUNT], counters[REGION_COUNT * COUNTER_COUNT];
+    double seconds[REGION_COUNT], operations[REGION_COUNT];
+    for (int r = 0; r < REGION_COUNT; ++r) {
+        const RegionProfile local = regionProfile(static_cast<Region>(r));
+        calls[r] = local.calls;
+        seconds[r] = local.seconds;
+        operations[r] = local.operations;
+        std::copy_n(local.counters, COUNTER_COUNT, &counters[r * COUNTER_COUNT]);
+    }
+    int counting = profilingCounters();
+
+    ProfileSummary summary;
+    MPI_Comm_size(comm, &summary.ranks);
+    std::uint64_t sumCalls[REGION_COUNT], sumCounters[REGION_COUNT * COUNTER_COUNT];
+    double sumSeconds[REGION_COUNT], sumOperations[REGION_COUNT];
+    int allCounting;
+    MPI_Reduce(calls, sumCalls, REGION_COUNT, MPI_UINT64_T, MPI_SUM, root, comm);
+    MPI_Reduce(seconds, sumSeconds, REGION_COUNT, MPI_DOUBLE, MPI_SUM, root, comm);
+    MPI_Reduce(seconds, summary.minSeconds, REGION_COUNT, MPI_DOUBLE, MPI_MIN, root, comm);
+    MPI_Reduce(seconds, summary.maxSeconds, REGION_COUNT, MPI_DOUBLE, MPI_MAX, root, comm);
+    MPI_Reduce(operations, sumOperations, REGION_COUNT, MPI_DOUBLE, MPI_SUM, root, comm);
+    MPI_Reduce(counters, sumCounters, REGION_COUNT * COUNTER_COUNT, MPI_UINT64_T, MPI_SUM, root, comm);
+    MPI_Reduce(&counting, &allCounting, 1, MPI_INT, MPI_MIN, root, comm);
+
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    if (rank == root) {
+        summary.counters = allCounting != 0;
+        for (int r = 0; r < REGION_COUNT; ++r) {
+            summary.total[r].calls = sumCalls[r];
+            summary.total[r].seconds = sumSeconds[r];
+            summary.total[r].operations = sumOperations[r];
+            std::copy_n(&sumCounters[r * COUNTER_COUNT], COUNTER_COUNT, summary.total[r].counters);
+        }
+    }
+    return summary;
+}
+
+std::string profileLine(const ProfileSummary& summary) {
+    std::ostringstream line;
+    line.setf(std::ios::fixed);
+    line.precision(6);
+    line << "Profile on " << summary.ranks << " ranks (slowest rank, calls of all ranks):";
+    const char* separator = " ";
+    for (int r = 0; r < REGION_COUNT; ++r) {
+        const RegionProfile& total = summary.total[r];
+        if (total.calls == 0) {
+            continue;
+        }
+        line << separator << REGION_NAMES[r] << " " << summary.maxSeconds[r] << " s x" << total.calls;
+        separator = " | ";
+        if (total.operations > 0 && summary.maxSeconds[r] > 0) {
+            line.precision(3);
+            line << ", " << total.operations / summary.maxSeconds[r] * 1e-9 << " GOP/s";
+            line.precision(6);
+        }
+        if (summary.counters && total.counters[0] > 0) {
+            line.precision(2);
+            line << ", IPC " << static_cast<double>(total.counters[1]) / total.counters[0] << ", "
+                 << total.counters[2] << " LLC misses";
+            line.precision(6);
+        }
+    }
+    return line.str();
+}
+
+bool writeProfileJson(const std::string& path, const ProfileSummary& summary) {
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+    std::fprintf(file, "{\n  \"ranks\": %d,\n  \"hardware_counters\": %s,\n  \"regions\": [", summary.ranks,
+                 summary.counters ? "true" : "false");
+    const char* separator = "\n";
+    for (int r = 0; r < REGION_COUNT; ++r) {
+        const RegionProfile& total = summary.total[r];
+        if (total.calls == 0) {
+            continue;
+        }
+        std::fprintf(file,
+                     "%s    {\"name\": \"%s\", \"calls\": %llu, \"seconds_min\": %.9f, \"seconds_max\": %.9f, "
+                     "\"seconds_sum\": %.9f, \"operations\": %.0f",
+                     separator, REGION_NAMES[r], static_cast<unsigned long long>(total.calls), summary.minSeconds[r],
+                     summary.maxSeconds[r], total.seconds, total.operations);
+        if (summary.counters) {
+            for (int c = 0; c < COUNTER_COUNT; ++c) {
+                std::fprintf(file, ", \"%s\": %llu", COUNTER_NAMES[c],
+                             static_cast<unsigned long long>(total.counters[c]));
+            }
+        }
+        std::fprintf(file, "}");
+        separator = ",\n";
+    }
+    std::fprintf(file, "\n  ]\n}\n");
+    return std::fclose(file) == 0;
+}
+
+bool writeTrace(const std::string& path, int root, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    // The events of this rank on its MPI_Wtime, as (name, thread, begin, end)
+    const double shift = MPI_Wtime() - steadySeconds(std::chrono::steady_clock::now());
+    std::vector<double> local;
+    for (const TraceEvent& e : traceEvents()) {
+        local.insert(local.end(), {static_cast<double>(e.name), static_cast<double>(e.thread), e.begin + shift,
+                                   e.end + shift});
+    }
+
+    // Offset of the MPI_Wtime of every rank to root's: the rank answers a message of root
+    // with its time, taken to be root's at the middle of the shortest round trip
+    std::vector<double> offsets(size, 0.0);
+    for (int r = 0; r < size; ++r) {
+        if (r == root || (rank != root && rank != r)) {
+            continue;
+        }
+        double shortest = -1.0;
+        for (int round = 0; round < TRACE_CLOCK_ROUNDS; ++round) {
+            double time = MPI_Wtime();
+            if (rank == root) {
+                const double sent = time;
+                MPI_Send(&time, 1, MPI_DOUBLE, r, 0, comm);
+                MPI_Recv(&time, 1, MPI_DOUBLE, r, 0, comm, MPI_STATUS_IGNORE);
+                const double received = MPI_Wtime();
+                if (shortest < 0 || received - sent < shortest) {
+                    shortest = received - sent;
+                    offsets[r] = time - (sent + received) / 2;
+                }
+            } else {
+                MPI_Recv(&time, 1, MPI_DOUBLE, root, 0, comm, MPI_STATUS_IGNORE);
+                time = MPI_Wtime();
+                MPI_Send(&time, 1, MPI_DOUBLE, root, 0, comm);
+            }
+        }
+    }
+
+    const int count = static_cast<int>(local.size());
+    std::vector<int> counts(rank == root ? size : 0), displs(counts.size());
+    MPI_Gather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, root, comm);
+    std::vector<double> all;
+    if (rank == root) {
+        for (int r = 1; r < size; ++r) {
+            displs[r] = displs[r - 1] + counts[r - 1];
+        }
+        all.resize(displs.back() + counts.back());
+    }
+    MPI_Gatherv(local.data(), count, MPI_DOUBLE, all.data(), counts.data(), displs.data(), MPI_DOUBLE, root, comm);
+    unsigned long long dropped = droppedTraceEvents(), allDropped = 0;
+    MPI_Reduce(&dropped, &allDropped, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, root, comm);
+    if (rank != root) {
+        return true;
+    }
+
+    // Timestamps in microseconds from the first event of the job
+    double origin = 0.0;
+    bool first = true;
+    for (int r = 0; r < size; ++r) {
+        for (int i = displs[r]; i < displs[r] + counts[r]; i += 4) {
+            origin = first ? all[i + 2] - offsets[r] : std::min(origin, all[i + 2] - offsets[r]);
+            first = false;
+        }
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+    std::fprintf(file, "{\"displayTimeUnit\": \"ms\",\n\"otherData\": {\"ranks\": %d, \"dropped_events\": %llu},\n"
+                       "\"traceEvents\": [",
+                 size, allDropped);
+    const char* separator = "\n";
+    for (int r = 0; r < size; ++r) {
+        std::fprintf(file, "%s{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+                           "\"args\": {\"name\": \"rank %d\"}}",
+                     separator, r, r);
+        separator = ",\n";
+        std::set<int> threads;
+        for (int i = displs[r]; i < displs[r] + counts[r]; i += 4) {
+            const int name = static_cast<int>(all[i]);
+            const int thread = static_cast<int>(all[i + 1]);
+            threads.insert(thread);
+            std::fprintf(file,
+                         ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": %d, \"tid\": %d, "
+                         "\"ts\": %.3f, \"dur\": %.3f}",
+                         name == TRACE_TILE ? "tile" : REGION_NAMES[name], TRACE_CATEGORIES[name], r, thread,
+                         (all[i + 2] - offsets[r] - origin) * 1e6, (all[i + 3] - all[i + 2]) * 1e6);
+        }
+        for (int thread : threads) {
+            const std::string name = thread == 0 ? "main" : "worker " + std::to_string(thread);
+            std::fprintf(file,
+                         ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, "
+                         "\"args\": {\"name\": \"%s\"}}",
+                         r, thread, name.c_str());
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+    return std::fclose(file) == 0;
+}
@@ -0,0 +1,166 @@
+#include "service.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+[[noreturn]] void fail(const std::string& what) {
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path too long: " + path);
+    }
+    std::strcpy(address.sun_path, path.c_str());
+    return address;
+}
+
+void writeAll(int fd, const std::string& data) {
+    std::size_t done = 0;
+    while (done < data.size()) {
+        const ssize_t n = ::send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fail("Error writing to socket");
+        }
+        done += static_cast<std::size_t>(n);
+    }
+}
+
+bool endsWith(const std::string& data, const std::string& end) {
+    return data.size() >= end.size() && data.compare(data.size() - end.size(), end.size(), end) == 0;
+}
+
+// Reads from fd until complete(data read so far) holds, or the peer closes; throws if the
+// read timeout of fd runs out first
+template <typename Complete>
+std::string readUntil(int fd, Complete complete) {
+    std::string data;
+    char buffer[4096];
+    while (!complete(data)) {
+        const ssize_t n = ::read(fd, buffer, sizeof(buffer));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                throw std::runtime_error("Timed out reading from socket");
+            }
+            fail("Error reading from socket");
+        }
+        if (n == 0) {
+            break;
+        }
+        data.append(buffer, static_cast<std::size_t>(n));
+    }
+    return data;
+}
+
+} // namespace
+
+int listenSocket(const std::string& path) {
+    const sockaddr_un address = socketAddress(path);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fail("Error creating socket");
+    }
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0 || ::listen(fd, 16) < 0) {
+        const int error = errno;
+        ::close(fd);
+        errno = error;
+        fail("Error listening on " + path);
+    }
+    return fd;
+}
+
+int acceptClient(int listener) {
+    for (;;) {
+        const int fd = ::accept(listener, nullptr, nullptr);
+        if (fd >= 0) {
+            return fd;
+        }
+        if (errno != EINTR) {
+            fail("Error accepting a client");
+        }
+    }
+}
+
+void setReadTimeout(int fd, int milliseconds) {
+    timeval timeout{};
+    timeout.tv_sec = milliseconds / 1000;
+    timeout.tv_usec = (milliseconds % 1000) * 1000;
+    if (::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
+        fail("Error setting the socket timeout");
+    }
+}
+
+int connectSocket(const std::string& path) {
+    const sockaddr_un address = socketAddress(path);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fail("Error creating socket");
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        const int error = errno;
+        ::close(fd);
+        errno = error;
+        fail("Error connecting to " + path);
+    }
+    return fd;
+}
+
+void writeRequest(int fd, const std::vector<std::string>& args) {
+    std::string data;
+    for (const std::string& arg : args) {
+        if (arg.empty() || arg.find('\n') != std::string::npos) {
+            throw std::runtime_error("Request arguments must be non-empty single lines");
+        }
+        data += arg + '\n';
+    }
+    writeAll(fd, data + '\n');
+}
+
+std::vector<std::string> readRequest(int fd) {
+    // An empty line ends the request, and is the whole request when it has no arguments
+    const std::string data =
+        readUntil(fd, [](const std::string& read) { return read == "\n" || endsWith(read, "\n\n"); });
+    std::vector<std::string> args;
+    std::size_t begin = 0;
+    for (std::size_t end; (end = data.find('\n', begin)) != std::string::npos && end > begin; begin = end + 1) {
+        args.push_back(data.substr(begin, end - begin));
+    }
+    return args;
+}
+
+void writeReply(int fd, const std::string& reply) {
+    writeAll(fd, reply + '\n');
+}
+
+std::string readReply(int fd) {
+    std::string reply = readUntil(fd, [](const std::string& read) { return endsWith(read, "\n"); });
+    if (!reply.empty() && reply.back() == '\n') {
+        reply.pop_back();
+    }
+    return reply;
+}
+
+std::string fileCacheKey(const std::string& path) {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) {
+        return std::string();
+    }
+    return path + ':' + std::to_string(info.st_size) + ':' + std::to_string(info.st_mtim.tv_sec) + '.' +
+           std::to_string(info.st_mtim.tv_nsec);
+}
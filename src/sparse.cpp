@@ -0,0 +1,303 @@
+#include "sparse.h"
+#include "profile.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+template <typename Acc>
+void checkDimensions(int aRows, int aCols, int bRows, int bCols, MatrixView<Acc> C) {
+    if (aCols != bRows || C.rows() != aRows || C.cols() != bCols) {
+        throw std::invalid_argument("sparse multiply: incompatible matrix dimensions");
+    }
+}
+
+// Row ranges handed to the pool by the SpGEMM phases: a few per thread, each with its own accumulator
+int rowChunks(int rows) {
+    return std::max(1, std::min(rows, 4 * ThreadPool::global().size()));
+}
+
+} // namespace
+
+template <typename T>
+double density(ConstMatrixView<T> dense) {
+    if (dense.empty()) {
+        return 0.0;
+    }
+    long long nonzeros = 0;
+    for (int i = 0; i < dense.rows(); ++i) {
+        const T* row = dense.row(i);
+        for (int j = 0; j < dense.cols(); ++j) {
+            nonzeros += row[j] != T();
+        }
+    }
+    return static_cast<double>(nonzeros) / (static_cast<double>(dense.rows()) * dense.cols());
+}
+
+template <typename T>
+CsrMatrix<T> toCsr(ConstMatrixView<T> dense) {
+    CsrMatrix<T> sparse;
+    sparse.rows = dense.rows();
+    sparse.cols = dense.cols();
+    sparse.rowPtr.assign(dense.rows() + 1, 0);
+    for (int i = 0; i < dense.rows(); ++i) {
+        const T* row = dense.row(i);
+        int count = 0;
+        for (int j = 0; j < dense.cols(); ++j) {
+            count += row[j] != T();
+        }
+        sparse.rowPtr[i + 1] = sparse.rowPtr[i] + count;
+    }
+
+    sparse.colIdx.resize(sparse.rowPtr.back());
+    sparse.values.resize(sparse.rowPtr.back());
+    for (int i = 0; i < dense.rows(); ++i) {
+        const T* row = dense.row(i);
+        int p = sparse.rowPtr[i];
+        for (int j = 0; j < dense.cols(); ++j) {
+            if (row[j] != T()) {
+                sparse.colIdx[p] = j;
+                sparse.values[p++] = row[j];
+            }
+        }
+    }
+    return sparse;
+}
+
+template <typename T>
+CscMatrix<T> toCsc(const CsrMatrix<T>& sparse) {
+    CscMatrix<T> csc;
+    csc.rows = sparse.rows;
+    csc.cols = sparse.cols;
+    csc.colPtr.assign(sparse.cols + 1, 0);
+    for (int j : sparse.colIdx) {
+        ++csc.colPtr[j + 1];
+    }
+    std::partial_sum(csc.colPtr.begin(), csc.colPtr.end(), csc.colPtr.begin());
+
+    // Counting sort by column; walking the rows in order keeps every column sorted by row
+    csc.rowIdx.resize(sparse.nnz());
+    csc.values.resize(sparse.nnz());
+    std::vector<int> next(csc.colPtr.begin(), csc.colPtr.end() - 1);
+    for (int i = 0; i < sparse.rows; ++i) {
+        for (int p = sparse.rowPtr[i]; p < sparse.rowPtr[i + 1]; ++p) {
+            const int q = next[sparse.colIdx[p]]++;
+            csc.rowIdx[q] = i;
+            csc.values[q] = sparse.values[p];
+        }
+    }
+    return csc;
+}
+
+template <typename T>
+Matrix<T> toDense(const CsrMatrix<T>& sparse) {
+    Matrix<T> dense(sparse.rows, sparse.cols);
+    for (int i = 0; i < sparse.rows; ++i) {
+        T* row = dense.row(i);
+        for (int p = sparse.rowPtr[i]; p < sparse.rowPtr[i + 1]; ++p) {
+            row[sparse.colIdx[p]] = sparse.values[p];
+        }
+    }
+    return dense;
+}
+
+template <typename T>
+CsrMatrix<T> csrFromTriplets(int rows, int cols, const std::vector<int>& rowIndex, const std::vector<int>& colIndex,
+                             const std::vector<T>& values) {
+    if (rows < 0 || cols < 0 || rowIndex.size() != values.size() || colIndex.size() != values.size()) {
+        throw std::invalid_argument("csrFromTriplets: invalid dimensions");
+    }
+    std::vector<int> count(rows + 1, 0);
+    for (std::size_t t = 0; t < values.size(); ++t) {
+        if (rowIndex[t] < 0 || rowIndex[t] >= rows || colIndex[t] < 0 || colIndex[t] >= cols) {
+            throw std::invalid_argument("csrFromTriplets: index out of range");
+        }
+        ++count[rowIndex[t] + 1];
+    }
+    std::partial_sum(count.begin(), count.end(), count.begin());
+
+    // Bucket the triplets by row, then sort every row by column and merge duplicates
+    std::vector<std::pair<int, T>> entries(values.size());
+    std::vector<int> next(count.begin(), count.end() - 1);
+    for (std::size_t t = 0; t < values.size(); ++t) {
+        entries[next[rowIndex[t]]++] = {colIndex[t], values[t]};
+    }
+
+    CsrMatrix<T> sparse;
+    sparse.rows = rows;
+    sparse.cols = cols;
+    sparse.rowPtr.assign(rows + 1, 0);
+    sparse.colIdx.reserve(values.size());
+    sparse.values.reserve(values.size());
+    for (int i = 0; i < rows; ++i) {
+        auto begin = entries.begin() + count[i];
+        auto end = entries.begin() + count[i + 1];
+        std::sort(begin, end, [](const auto& x, const auto& y) { return x.first < y.first; });
+        for (auto it = begin; it != end;) {
+            const int col = it->first;
+            T sum = T();
+            for (; it != end && it->first == col; ++it) {
+                sum += it->second;
+            }
+            if (sum != T()) {
+                sparse.colIdx.push_back(col);
+                sparse.values.push_back(sum);
+            }
+        }
+        sparse.rowPtr[i + 1] = sparse.nnz();
+    }
+    return sparse;
+}
+
+template <typename T, typename Acc>
+void multiplySparseDense(const CsrMatrix<T>& A, ConstMatrixView<T> B, MatrixView<Acc> C) {
+    PROFILE_SCOPE(Region::Multiply, 2.0 * A.nnz() * B.cols());
+    checkDimensions(A.rows, A.cols, B.rows(), B.cols(), C);
+    const int N = B.cols();
+    ThreadPool::global().parallelFor(A.rows, [&](int i) {
+        Acc* c = C.row(i);
+        // A strip of the row of C stays in registers while every nonzero of row i of A
+        // streams its segment of B past it, instead of reloading and storing C per nonzero
+        constexpr int STRIP = 256 / sizeof(Acc);
+        int j = 0;
+        for (; j + STRIP <= N; j += STRIP) {
+            Acc acc[STRIP] = {};
+            for (int p = A.rowPtr[i]; p < A.rowPtr[i + 1]; ++p) {
+                const Acc a = A.values[p];
+                const T* b = B.row(A.colIdx[p]) + j;
+                for (int w = 0; w < STRIP; ++w) {
+                    acc[w] += a * static_cast<Acc>(b[w]);
+                }
+            }
+            std::copy_n(acc, STRIP, c + j);
+        }
+        std::fill(c + j, c + N, Acc());
+        for (int p = A.rowPtr[i]; p < A.rowPtr[i + 1]; ++p) {
+            const Acc a = A.values[p];
+            const T* b = B.row(A.colIdx[p]);
+            for (int jj = j; jj < N; ++jj) {
+                c[jj] += a * static_cast<Acc>(b[jj]);
+            }
+        }
+    });
+}
+
+template <typename T, typename Acc>
+void multiplyDenseSparse(ConstMatrixView<T> A, const CscMatrix<T>& B, MatrixView<Acc> C) {
+    PROFILE_SCOPE(Region::Multiply, 2.0 * A.rows() * B.nnz());
+    checkDimensions(A.rows(), A.cols(), B.rows, B.cols, C);
+    ThreadPool::global().parallelFor(A.rows(), [&](int i) {
+        const T* a = A.row(i);
+        Acc* c = C.row(i);
+        for (int j = 0; j < B.cols; ++j) {
+            Acc sum = Acc();
+            for (int p = B.colPtr[j]; p < B.colPtr[j + 1]; ++p) {
+                sum += static_cast<Acc>(a[B.rowIdx[p]]) * static_cast<Acc>(B.values[p]);
+            }
+            c[j] = sum;
+        }
+    });
+}
+
+template <typename T, typename Acc>
+CsrMatrix<Acc> multiplySparse(const CsrMatrix<T>& A, const CsrMatrix<T>& B) {
+    PROFILE_SCOPE(Region::Multiply);
+    if (A.cols != B.rows) {
+        throw std::invalid_argument("multiplySparse: incompatible matrix dimensions");
+    }
+    CsrMatrix<Acc> C;
+    C.rows = A.rows;
+    C.cols = B.cols;
+    C.rowPtr.assign(A.rows + 1, 0);
+    ThreadPool& pool = ThreadPool::global();
+    const int chunks = rowChunks(A.rows);
+    auto chunkBegin = [&](int chunk) { return static_cast<int>(static_cast<long long>(A.rows) * chunk / chunks); };
+
+    // Symbolic phase: number of distinct columns reached by every row of C
+    pool.parallelFor(chunks, [&](int chunk) {
+        std::vector<int> mark(B.cols, -1);
+        for (int i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i) {
+            int count = 0;
+            for (int p = A.rowPtr[i]; p < A.rowPtr[i + 1]; ++p) {
+                const int k = A.colIdx[p];
+                for (int q = B.rowPtr[k]; q < B.rowPtr[k + 1]; ++q) {
+                    if (mark[B.colIdx[q]] != i) {
+                        mark[B.colIdx[q]] = i;
+                        ++count;
+                    }
+                }
+            }
+            C.rowPtr[i + 1] = count;
+        }
+    });
+    std::partial_sum(C.rowPtr.begin(), C.rowPtr.end(), C.rowPtr.begin());
+    C.colIdx.resize(C.rowPtr.back());
+    C.values.resize(C.rowPtr.back());
+
+    // Numeric phase: accumulate each row densely, then store its columns in order
+    pool.parallelFor(chunks, [&](int chunk) {
+        std::vector<Acc> acc(B.cols, Acc());
+        std::vector<int> mark(B.cols, -1);
+        for (int i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i) {
+            int* cols = C.colIdx.data() + C.rowPtr[i];
+            int count = 0;
+            for (int p = A.rowPtr[i]; p < A.rowPtr[i + 1]; ++p) {
+                const Acc a = A.values[p];
+                const int k = A.colIdx[p];
+                for (int q = B.rowPtr[k]; q < B.rowPtr[k + 1]; ++q) {
+                    const int j = B.colIdx[q];
+                    if (mark[j] != i) {
+                        mark[j] = i;
+                        cols[count++] = j;
+                    }
+                    acc[j] += a * static_cast<Acc>(B.values[q]);
+                }
+            }
+            std::sort(cols, cols + count);
+            Acc* values = C.values.data() + C.rowPtr[i];
+            for (int p = 0; p < count; ++p) {
+                values[p] = acc[cols[p]];
+                acc[cols[p]] = Acc();
+            }
+        }
+    });
+    return C;
+}
+
+#define INSTANTIATE_SPARSE(T)                                                                                         \
+    template double density<T>(ConstMatrixView<T>);                                                                   \
+    template CsrMatrix<T> toCsr<T>(ConstMatrixView<T>);                                                               \
+    template CscMatrix<T> toCsc<T>(const CsrMatrix<T>&);                                                              \
+    template Matrix<T> toDense<T>(const CsrMatrix<T>&);                                                               \
+    template CsrMatrix<T> csrFromTriplets<T>(int, int, const std::vector<int>&, const std::vector<int>&,              \
+                                             const std::vector<T>&);
+
+#define INSTANTIATE_SPARSE_MULTIPLY(T, Acc)                                                                           \
+    template void multiplySparseDense<T, Acc>(const CsrMatrix<T>&, ConstMatrixView<T>, MatrixView<Acc>);              \
+    template void multiplyDenseSparse<T, Acc>(ConstMatrixView<T>, const CscMatrix<T>&, MatrixView<Acc>);              \
+    template CsrMatrix<Acc> multiplySparse<T, Acc>(const CsrMatrix<T>&, const CsrMatrix<T>&);
+
+INSTANTIATE_SPARSE(std::int8_t)
+INSTANTIATE_SPARSE(std::int16_t)
+INSTANTIATE_SPARSE(std::int32_t)
+INSTANTIATE_SPARSE(std::int64_t)
+INSTANTIATE_SPARSE(float)
+INSTANTIATE_SPARSE(double)
+
+INSTANTIATE_SPARSE_MULTIPLY(std::int8_t, std::int32_t)
+INSTANTIATE_SPARSE_MULTIPLY(std::int8_t, std::int64_t)
+INSTANTIATE_SPARSE_MULTIPLY(std::int16_t, std::int32_t)
+INSTANTIATE_SPARSE_MULTIPLY(std::int16_t, std::int64_t)
+INSTANTIATE_SPARSE_MULTIPLY(std::int32_t, std::int32_t)
+INSTANTIATE_SPARSE_MULTIPLY(std::int32_t, std::int64_t)
+INSTANTIATE_SPARSE_MULTIPLY(std::int64_t, std::int64_t)
+INSTANTIATE_SPARSE_MULTIPLY(float, float)
+INSTANTIATE_SPARSE_MULTIPLY(float, double)
+INSTANTIATE_SPARSE_MULTIPLY(double, double)
+
+#undef INSTANTIATE_SPARSE
+#undef INSTANTIATE_SPARSE_MULTIPLY
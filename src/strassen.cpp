@@ -0,0 +1,291 @@
+#include "strassen.h"
+#include "matrix_multiplication.h"
+#include "profile.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <new>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+// Every region of the arena starts on its own cache line
+std::size_t roundUp(std::size_t count) {
+    const std::size_t line = MATRIX_ALIGNMENT / sizeof(int);
+    return (count + line - 1) / line * line;
+}
+
+int paddedSize(int n, int depth) {
+    const int step = 1 << depth;
+    return (n + step - 1) / step * step;
+}
+
+// Scratch needed by one level of the recursion and all the levels below it
+std::size_t levelScratch(int m, int k, int n, int depth) {
+    std::size_t total = 0;
+    for (int level = 0; level < depth; ++level) {
+        m /= 2;
+        k /= 2;
+        n /= 2;
+        total += roundUp(static_cast<std::size_t>(m) * std::max(k, n)) + roundUp(static_cast<std::size_t>(k) * n);
+    }
+    return total;
+}
+
+bool needsPadding(int M, int K, int N, int depth) {
+    return paddedSize(M, depth) != M || paddedSize(K, depth) != K || paddedSize(N, depth) != N;
+}
+
+std::size_t workspaceSize(int M, int K, int N, int depth) {
+    const int Mp = paddedSize(M, depth);
+    const int Kp = paddedSize(K, depth);
+    const int Np = paddedSize(N, depth);
+    std::size_t total = levelScratch(Mp, Kp, Np, depth);
+    if (needsPadding(M, K, N, depth)) {
+        total += roundUp(static_cast<std::size_t>(Mp) * Kp) + roundUp(static_cast<std::size_t>(Kp) * Np) +
+                 roundUp(static_cast<std::size_t>(Mp) * Np);
+    }
+    return total;
+}
+
+// Element-wise out = x + y and out = x - y. The arithmetic is done on unsigned values so
+// that overflow wraps exactly like the products do; out may alias x or y
+void add(ConstMatrixView<int> x, ConstMatrixView<int> y, MatrixView<int> out) {
+    ThreadPool::global().parallelFor(out.rows(), [&](int i) {
+        const int* a = x.row(i);
+        const int* b = y.row(i);
+        int* c = out.row(i);
+        for (int j = 0; j < out.cols(); ++j) {
+            c[j] = static_cast<int>(static_cast<unsigned>(a[j]) + static_cast<unsigned>(b[j]));
+        }
+    });
+}
+
+void sub(ConstMatrixView<int> x, ConstMatrixView<int> y, MatrixView<int> out) {
+    ThreadPool::global().parallelFor(out.rows(), [&](int i) {
+        const int* a = x.row(i);
+        const int* b = y.row(i);
+        int* c = out.row(i);
+        for (int j = 0; j < out.cols(); ++j) {
+            c[j] = static_cast<int>(static_cast<unsigned>(a[j]) - static_cast<unsigned>(b[j]));
+        }
+    });
+}
+
+// Copies src into the top-left corner of dst and zeroes the rest of dst
+void copyPadded(ConstMatrixView<int> src, MatrixView<int> dst) {
+    for (int i = 0; i < dst.rows(); ++i) {
+        int* out = dst.row(i);
+        if (i < src.rows()) {
+            std::copy_n(src.row(i), src.cols(), out);
+            std::fill(out + src.cols(), out + dst.cols(), 0);
+        } else {
+            std::fill_n(out, dst.cols(), 0);
+        }
+    }
+}
+
+/*
+ * One level of Strassen-Winograd with the schedule of Douglas et al. (GEMMW): the
+ * seven products land directly in the quadrants of C, so besides C the level only
+ * needs X (size of A11, later of C11) and Y (size of B11) from the scratch.
+ */
+void winograd(ConstMatrixView<int> A, ConstMatrixView<int> B, MatrixView<int> C, int depth, int* scratch) {
+    if (depth == 0) {
+        multiplyMatrices(A, B, C);
+        return;
+    }
+
+    const int m = A.rows() / 2;
+    const int k = A.cols() / 2;
+    const int n = B.cols() / 2;
+    ConstMatrixView<int> A11 = A.block(0, 0, m, k), A12 = A.block(0, k, m, k);
+    ConstMatrixView<int> A21 = A.block(m, 0, m, k), A22 = A.block(m, k, m, k);
+    ConstMatrixView<int> B11 = B.block(0, 0, k, n), B12 = B.block(0, n, k, n);
+    ConstMatrixView<int> B21 = B.block(k, 0, k, n), B22 = B.block(k, n, k, n);
+    MatrixView<int> C11 = C.block(0, 0, m, n), C12 = C.block(0, n, m, n);
+    MatrixView<int> C21 = C.block(m, 0, m, n), C22 = C.block(m, n, m, n);
+
+    int* y = scratch + roundUp(static_cast<std::size_t>(m) * std::max(k, n));
+    int* next = y + roundUp(static_cast<std::size_t>(k) * n);
+    MatrixView<int> X(scratch, m, k);
+    MatrixView<int> Y(y, k, n);
+    MatrixView<int> P1(scratch, m, n);
+
+    sub(A11, A21, X); // S3
+    sub(B22, B12, Y); // T3
+    winograd(X, Y, C21, depth - 1, next); // P7
+    add(A21, A22, X); // S1
+    sub(B12, B11, Y); // T1
+    winograd(X, Y, C22, depth - 1, next); // P5
+    sub(X, A11, X); // S2 = S1 - A11
+    sub(B22, Y, Y); // T2 = B22 - T1
+    winograd(X, Y, C12, depth - 1, next); // P6
+    sub(A12, X, X); // S4 = A12 - S2
+    winograd(X, B22, C11, depth - 1, next); // P3
+    winograd(A11, B11, P1, depth - 1, next); // P1 (X is free again)
+    add(P1, C12, C12); // U2 = P1 + P6
+    add(C12, C21, C21); // U3 = U2 + P7
+    add(C12, C22, C12); // U4 = U2 + P5
+    add(C21, C22, C22); // U7 = U3 + P5 = C22
+    add(C12, C11, C12); // U5 = U4 + P3 = C12
+    sub(Y, B21, Y); // T4 = T2 - B21
+    winograd(A22, Y, C11, depth - 1, next); // P4
+    sub(C21, C11, C21); // U6 = U3 - P4 = C21
+    winograd(A12, B21, C11, depth - 1, next); // P2
+    add(P1, C11, C11); // U1 = P1 + P2 = C11
+}
+
+int& currentCutoff() {
+    static int cutoff = [] {
+        int c = 512;
+        loadStrassenCutoff(tileConfigPath(), c);
+        return c;
+    }();
+    return cutoff;
+}
+
+double timeProduct(ConstMatrixView<int> A, ConstMatrixView<int> B, MatrixView<int> C, int cutoff,
+                   StrassenWorkspace& workspace) {
+    double best = 1e30;
+    for (int rep = 0; rep < 2; ++rep) {
+        auto start = std::chrono::steady_clock::now();
+        multiplyStrassen(A, B, C, cutoff, workspace);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+} // namespace
+
+void StrassenWorkspace::reserve(int M, int K, int N, int cutoff) {
+    const std::size_t count = workspaceSize(M, K, N, strassenDepth(M, K, N, cutoff));
+    if (count <= capacity_) {
+        return;
+    }
+    void* p = std::aligned_alloc(MATRIX_ALIGNMENT, count * sizeof(int));
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    data_.reset(static_cast<int*>(p));
+    capacity_ = count;
+}
+
+int strassenDepth(int M, int K, int N, int cutoff) {
+    if (cutoff < 1) {
+        throw std::invalid_argument("multiplyStrassen: cutoff must be positive");
+    }
+    int depth = 0;
+    while ((std::min({M, K, N}) >> depth) > cutoff) {
+        ++depth;
+    }
+    return depth;
+}
+
+void multiplyStrassen(ConstMatrixView<int> A, ConstMatrixView<int> B, MatrixView<int> C, int cutoff,
+                      StrassenWorkspace& workspace) {
+    // Counted as the 2 M N K operations of the classical product, like the benchmarks do
+    PROFILE_SCOPE(Region::Multiply, 2.0 * A.rows() * A.cols() * B.cols());
+    if (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols()) {
+        throw std::invalid_argument("multiplyStrassen: incompatible matrix dimensions");
+    }
+    const int M = A.rows();
+    const int K = A.cols();
+    const int N = B.cols();
+    const int depth = strassenDepth(M, K, N, cutoff);
+    if (depth == 0) {
+        multiplyMatrices(A, B, C);
+        return;
+    }
+
+    workspace.reserve(M, K, N, cutoff);
+    int* scratch = workspace.data();
+    if (!needsPadding(M, K, N, depth)) {
+        winograd(A, B, C, depth, scratch);
+        return;
+    }
+
+    // Pad every dimension up to a multiple of 2^depth so that each level halves evenly
+    const int Mp = paddedSize(M, depth);
+    const int Kp = paddedSize(K, depth);
+    const int Np = paddedSize(N, depth);
+    MatrixView<int> Ap(scratch, Mp, Kp);
+    scratch += roundUp(static_cast<std::size_t>(Mp) * Kp);
+    MatrixView<int> Bp(scratch, Kp, Np);
+    scratch += roundUp(static_cast<std::size_t>(Kp) * Np);
+    MatrixView<int> Cp(scratch, Mp, Np);
+    scratch += roundUp(static_cast<std::size_t>(Mp) * Np);
+
+    copyPadded(A, Ap);
+    copyPadded(B, Bp);
+    winograd(Ap, Bp, Cp, depth, scratch);
+    for (int i = 0; i < M; ++i) {
+        std::copy_n(Cp.row(i), N, C.row(i));
+    }
+}
+
+void multiplyStrassen(ConstMatrixView<int> A, ConstMatrixView<int> B, MatrixView<int> C, int cutoff) {
+    StrassenWorkspace workspace;
+    multiplyStrassen(A, B, C, cutoff, workspace);
+}
+
+int strassenCutoff() {
+    return currentCutoff();
+}
+
+void setStrassenCutoff(int cutoff) {
+    if (cutoff > 0) {
+        currentCutoff() = cutoff;
+    }
+}
+
+bool loadStrassenCutoff(const std::string& path, int& cutoff) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+
+    std::string key;
+    int value;
+    while (in >> key >> value) {
+        if (key == "strassen" && value > 0) {
+            cutoff = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool saveStrassenCutoff(const std::string& path, int cutoff) {
+    std::ofstream out(path, std::ios::app);
+    out << "strassen " << cutoff << "\n";
+    return static_cast<bool>(out);
+}
+
+int autotuneStrassenCutoff(int maxN) {
+    Matrix<int> A(maxN, maxN), B(maxN, maxN), C(maxN, maxN);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> dis(-100, 100);
+    for (int i = 0; i < maxN; ++i) {
+        for (int j = 0; j < maxN; ++j) {
+            A(i, j) = dis(gen);
+            B(i, j) = dis(gen);
+        }
+    }
+
+    // The smallest n at which one level (cutoff n - 1) beats the classical kernel (cutoff n)
+    // sets the cutoff halfway between n / 2, which did not pay off, and n
+    StrassenWorkspace workspace(maxN, maxN, maxN, 1);
+    for (int n = 256; n <= maxN; n *= 2) {
+        ConstMatrixView<int> a = A.block(0, 0, n, n);
+        ConstMatrixView<int> b = B.block(0, 0, n, n);
+        MatrixView<int> c = C.block(0, 0, n, n);
+        if (timeProduct(a, b, c, n - 1, workspace) < timeProduct(a, b, c, n, workspace)) {
+            return 3 * n / 4;
+        }
+    }
+    return 2 * maxN;
+}
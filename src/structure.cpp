@@ -0,0 +1,234 @@
+#include "structure.h"
+#include "kernels.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+
+template <typename T, typename Acc>
+void checkDimensions(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C) {
+    if (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols()) {
+        throw std::invalid_argument("multiplyStructured: incompatible matrix dimensions");
+    }
+}
+
+// Row i of a diagonal A (offset o) picks row i + o of B, scaled by A(i, i + o)
+template <typename T, typename Acc>
+void scaleRows(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C, int offset, bool identity) {
+    ThreadPool::global().parallelFor(C.rows(), [&](int i) {
+        Acc* c = C.row(i);
+        const int k = i + offset;
+        if (k < 0 || k >= B.rows()) {
+            std::fill_n(c, C.cols(), Acc());
+            return;
+        }
+        const T* b = B.row(k);
+        if (identity) {
+            std::transform(b, b + C.cols(), c, [](T x) { return static_cast<Acc>(x); });
+        } else {
+            const Acc scale = static_cast<Acc>(A(i, k));
+            std::transform(b, b + C.cols(), c, [scale](T x) { return scale * static_cast<Acc>(x); });
+        }
+    });
+}
+
+// Column j of C is column j of A scaled by B(j, j), or zero past the diagonal of B
+template <typename T, typename Acc>
+void scaleColumns(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C, bool identity) {
+    const int diagonal = std::min(B.rows(), B.cols());
+    ThreadPool::global().parallelFor(C.rows(), [&](int i) {
+        const T* a = A.row(i);
+        Acc* c = C.row(i);
+        for (int j = 0; j < diagonal; ++j) {
+            c[j] = identity ? static_cast<Acc>(a[j]) : static_cast<Acc>(a[j]) * static_cast<Acc>(B(j, j));
+        }
+        std::fill(c + diagonal, c + C.cols(), Acc());
+    });
+}
+
+// Tiled product over the STRUCTURE_TILE grid: tile (I, J) of C sums A(I, P) * B(P, J) over
+// the P for which neither tile is known to be zero
+template <typename T, typename Acc>
+void multiplySkippingZeroTiles(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C, const ZeroTiles& zeroA,
+                               const ZeroTiles& zeroB) {
+    const int M = A.rows();
+    const int K = A.cols();
+    const int N = B.cols();
+    const BlockKernelOf<T, Acc> kernel = blockKernelFor<T, Acc>(activeIsa());
+    const int rowTiles = zeroA.rowTiles;
+    const int depthTiles = zeroA.colTiles;
+    const int colTiles = zeroB.colTiles;
+
+    // Consecutive tasks go down a column of C tiles, sharing the same column panel of B
+    ThreadPool::global().parallelFor(rowTiles * colTiles, [&](int tile) {
+        const int I = tile % rowTiles;
+        const int J = tile / rowTiles;
+        const int ic = I * STRUCTURE_TILE;
+        const int jc = J * STRUCTURE_TILE;
+        const int rows = std::min(STRUCTURE_TILE, M - ic);
+        const int nb = std::min(STRUCTURE_TILE, N - jc);
+        for (int i = 0; i < rows; ++i) {
+            std::fill_n(C.row(ic + i) + jc, nb, Acc());
+        }
+        for (int P = 0; P < depthTiles; ++P) {
+            if (zeroA(I, P) || zeroB(P, J)) {
+                continue;
+            }
+            const int pc = P * STRUCTURE_TILE;
+            const int kb = std::min(STRUCTURE_TILE, K - pc);
+            kernel(A.row(ic) + pc, A.stride(), B.row(pc) + jc, B.stride(), C.row(ic) + jc, C.stride(), rows, nb, kb);
+        }
+    });
+}
+
+} // namespace
+
+const char* structureName(Structure structure) {
+    switch (structure) {
+    case Structure::General:
+        return "general";
+    case Structure::Zero:
+        return "zero";
+    case Structure::Identity:
+        return "identity";
+    case Structure::Diagonal:
+        return "diagonal";
+    case Structure::UpperTriangular:
+        return "upper triangular";
+    case Structure::LowerTriangular:
+        return "lower triangular";
+    }
+    return "unknown";
+}
+
+template <typename T>
+Structure detectStructure(ConstMatrixView<T> m, int diagonalOffset) {
+    bool below = false; // nonzeros left of the diagonal
+    bool above = false; // nonzeros right of the diagonal
+    bool onDiagonal = false;
+    bool unitDiagonal = true;
+    for (int i = 0; i < m.rows() && !(below && above); ++i) {
+        const T* row = m.row(i);
+        const int d = i + diagonalOffset;
+        for (int j = 0; j < m.cols(); ++j) {
+            if (row[j] == T()) {
+                if (j == d) {
+                    unitDiagonal = false;
+                }
+                continue;
+            }
+            if (j < d) {
+                below = true;
+            } else if (j > d) {
+                above = true;
+            } else {
+                onDiagonal = true;
+                unitDiagonal = unitDiagonal && row[j] == T(1);
+            }
+        }
+        // A row whose diagonal element falls outside the matrix breaks the identity
+        if (d < 0 || d >= m.cols()) {
+            unitDiagonal = false;
+        }
+    }
+
+    if (below && above) {
+        return Structure::General;
+    }
+    if (below) {
+        return Structure::LowerTriangular;
+    }
+    if (above) {
+        return Structure::UpperTriangular;
+    }
+    if (!onDiagonal) {
+        return Structure::Zero;
+    }
+    return unitDiagonal ? Structure::Identity : Structure::Diagonal;
+}
+
+template <typename T>
+ZeroTiles findZeroTiles(ConstMatrixView<T> m) {
+    ZeroTiles tiles;
+    tiles.rowTiles = (m.rows() + STRUCTURE_TILE - 1) / STRUCTURE_TILE;
+    tiles.colTiles = (m.cols() + STRUCTURE_TILE - 1) / STRUCTURE_TILE;
+    tiles.zero.assign(static_cast<std::size_t>(tiles.rowTiles) * tiles.colTiles, 0);
+    for (int I = 0; I < tiles.rowTiles; ++I) {
+        const int rowEnd = std::min(m.rows(), (I + 1) * STRUCTURE_TILE);
+        for (int J = 0; J < tiles.colTiles; ++J) {
+            const int colBegin = J * STRUCTURE_TILE;
+            const int colEnd = std::min(m.cols(), colBegin + STRUCTURE_TILE);
+            bool zero = true;
+            for (int i = I * STRUCTURE_TILE; i < rowEnd && zero; ++i) {
+                const T* row = m.row(i);
+                zero = std::all_of(row + colBegin, row + colEnd, [](T x) { return x == T(); });
+            }
+            tiles.zero[static_cast<std::size_t>(I) * tiles.colTiles + J] = zero;
+            tiles.count += zero;
+        }
+    }
+    return tiles;
+}
+
+template <typename T, typename Acc>
+bool multiplyStructured(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<Acc> C, int diagonalOffset) {
+    checkDimensions(A, B, C);
+    if (std::min({A.rows(), A.cols(), B.cols()}) < STRUCTURE_MIN_DIM) {
+        return false;
+    }
+
+    const Structure a = detectStructure(A, diagonalOffset);
+    const Structure b = detectStructure(B);
+    if (a == Structure::Zero || b == Structure::Zero) {
+        for (int i = 0; i < C.rows(); ++i) {
+            std::fill_n(C.row(i), C.cols(), Acc());
+        }
+        return true;
+    }
+    if (a == Structure::Identity || a == Structure::Diagonal) {
+        scaleRows(A, B, C, diagonalOffset, a == Structure::Identity);
+        return true;
+    }
+    if (b == Structure::Identity || b == Structure::Diagonal) {
+        scaleColumns(A, B, C, b == Structure::Identity);
+        return true;
+    }
+
+    const ZeroTiles zeroA = findZeroTiles(A);
+    const ZeroTiles zeroB = findZeroTiles(B);
+    if (zeroA.count == 0 && zeroB.count == 0) {
+        return false;
+    }
+    multiplySkippingZeroTiles(A, B, C, zeroA, zeroB);
+    return true;
+}
+
+#define INSTANTIATE_STRUCTURE(T)                                                                                      \
+    template Structure detectStructure<T>(ConstMatrixView<T>, int);                                                   \
+    template ZeroTiles findZeroTiles<T>(ConstMatrixView<T>);
+
+#define INSTANTIATE_STRUCTURED_MULTIPLY(T, Acc)                                                                       \
+    template bool multiplyStructured<T, Acc>(ConstMatrixView<T>, ConstMatrixView<T>, MatrixView<Acc>, int);
+
+INSTANTIATE_STRUCTURE(std::int8_t)
+INSTANTIATE_STRUCTURE(std::int16_t)
+INSTANTIATE_STRUCTURE(std::int32_t)
+INSTANTIATE_STRUCTURE(std::int64_t)
+INSTANTIATE_STRUCTURE(float)
+INSTANTIATE_STRUCTURE(double)
+
+INSTANTIATE_STRUCTURED_MULTIPLY(std::int8_t, std::int32_t)
+INSTANTIATE_STRUCTURED_MULTIPLY(std::int8_t, std::int64_t)
+INSTANTIATE_STRUCTURED_MULTIPLY(std::int16_t, std::int32_t)
+INSTANTIATE_STRUCTURED_MULTIPLY(std::int16_t, std::int64_t)
+INSTANTIATE_STRUCTURED_MULTIPLY(std::int32_t, std::int32_t)
+INSTANTIATE_STRUCTURED_MULTIPLY(std::int32_t, std::int64_t)
+INSTANTIATE_STRUCTURED_MULTIPLY(std::int64_t, std::int64_t)
+INSTANTIATE_STRUCTURED_MULTIPLY(float, float)
+INSTANTIATE_STRUCTURED_MULTIPLY(float, double)
+INSTANTIATE_STRUCTURED_MULTIPLY(double, double)
+
+#undef INSTANTIATE_STRUCTURE
+#undef INSTANTIATE_STRUCTURED_MULTIPLY
@@ -0,0 +1,67 @@
+#include "summa.h"
+#include "matrix_multiplication.h"
+#include <algorithm>
+#include <cstdint>
+
+template <typename T, typename Acc>
+void summaMultiply(ConstMatrixView<T> localA, ConstMatrixView<T> localB, MatrixView<Acc> localC, int K,
+                   int blockSize, const ProcessGrid& grid) {
+    for (int i = 0; i < localC.rows(); ++i) {
+        std::fill_n(localC.row(i), localC.cols(), Acc());
+    }
+
+    Matrix<T> panelA(localC.rows(), blockSize);
+    Matrix<T> panelB(blockSize, localC.cols());
+
+    const int blocks = (K + blockSize - 1) / blockSize;
+    for (int kb = 0; kb < blocks; ++kb) {
+        const int width = std::min(blockSize, K - kb * blockSize);
+        const int ownerCol = kb % grid.cols;
+        const int ownerRow = kb % grid.rows;
+
+        // Block column kb of A lives on grid column ownerCol, as local block kb / cols
+        MatrixView<T> a(panelA.data(), localC.rows(), width);
+        if (grid.myCol == ownerCol) {
+            ConstMatrixView<T> src = localA.block(0, (kb / grid.cols) * blockSize, localA.rows(), width);
+            for (int i = 0; i < src.rows(); ++i) {
+                std::copy_n(src.row(i), width, a.row(i));
+            }
+        }
+        {
+            PROFILE_SCOPE(Region::Broadcast);
+            MPI_Bcast(a.data(), a.rows() * width, mpiType<T>(), ownerCol, grid.rowComm);
+        }
+
+        // Block row kb of B lives on grid row ownerRow, as local block kb / rows
+        MatrixView<T> b(panelB.data(), width, localC.cols());
+        if (grid.myRow == ownerRow) {
+            ConstMatrixView<T> src = localB.block((kb / grid.rows) * blockSize, 0, width, localB.cols());
+            for (int i = 0; i < width; ++i) {
+                std::copy_n(src.row(i), src.cols(), b.row(i));
+            }
+        }
+        {
+            PROFILE_SCOPE(Region::Broadcast);
+            MPI_Bcast(b.data(), width * b.cols(), mpiType<T>(), ownerRow, grid.colComm);
+        }
+
+        multiplyAccumulate<T, Acc>(a, b, localC);
+    }
+}
+
+#define INSTANTIATE_SUMMA(T, Acc)                                                                                     \
+    template void summaMultiply<T, Acc>(ConstMatrixView<T>, ConstMatrixView<T>, MatrixView<Acc>, int, int,           \
+                                        const ProcessGrid&);
+
+INSTANTIATE_SUMMA(std::int8_t, std::int32_t)
+INSTANTIATE_SUMMA(std::int8_t, std::int64_t)
+INSTANTIATE_SUMMA(std::int16_t, std::int32_t)
+INSTANTIATE_SUMMA(std::int16_t, std::int64_t)
+INSTANTIATE_SUMMA(std::int32_t, std::int32_t)
+INSTANTIATE_SUMMA(std::int32_t, std::int64_t)
+INSTANTIATE_SUMMA(std::int64_t, std::int64_t)
+INSTANTIATE_SUMMA(float, float)
+INSTANTIATE_SUMMA(float, double)
+INSTANTIATE_SUMMA(double, double)
+
+#undef INSTANTIATE_SUMMA
@@ -0,0 +1,183 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+
+// Binds the calling thread to the index-th CPU of the process affinity mask
+void pinCurrentThread(int index) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+        return;
+    }
+    int target = index % CPU_COUNT(&allowed);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed) && target-- == 0) {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+            return;
+        }
+    }
+}
+
+int envThreads() {
+    const char* value = std::getenv("MATMUL_THREADS");
+    int threads = value != nullptr ? std::atoi(value) : 1;
+    return std::max(threads, 1);
+}
+
+bool envPin() {
+    const char* value = std::getenv("MATMUL_PIN");
+    return value != nullptr && *value != '\0' && *value != '0';
+}
+
+// Set on the pool threads, and on the caller while it runs a loop: a parallelFor from there
+// is nested and must not overwrite the state of the loop in progress
+thread_local bool inLoop = false;
+
+std::unique_ptr<ThreadPool>& globalPool() {
+    static std::unique_ptr<ThreadPool> pool;
+    return pool;
+}
+
+} // namespace
+
+ThreadPool::ThreadPool(int threads, bool pin) : ranges_(std::max(threads, 1)) {
+    if (pin) {
+        pinCurrentThread(0);
+    }
+    for (int id = 1; id < size(); ++id) {
+        workers_.emplace_back([this, id, pin] {
+            if (pin) {
+                pinCurrentThread(id);
+            }
+            workerLoop(id);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::global() {
+    std::unique_ptr<ThreadPool>& pool = globalPool();
+    if (!pool) {
+        pool = std::make_unique<ThreadPool>(envThreads(), envPin());
+    }
+    return *pool;
+}
+
+void ThreadPool::setThreads(int threads, bool pin) {
+    globalPool() = std::make_unique<ThreadPool>(threads, pin);
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& task) {
+    if (size() == 1 || count <= 1 || inLoop) {
+        for (int i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    const int threads = size();
+    for (int id = 0; id < threads; ++id) {
+        std::lock_guard<std::mutex> lock(ranges_[id].mutex);
+        ranges_[id].begin = static_cast<int>(static_cast<long long>(count) * id / threads);
+        ranges_[id].end = static_cast<int>(static_cast<long long>(count) * (id + 1) / threads);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        running_ = threads - 1;
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    inLoop = true;
+    runTasks(0);
+    inLoop = false;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return running_ == 0; });
+    task_ = nullptr;
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+void ThreadPool::workerLoop(int id) {
+    inLoop = true;
+    std::uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+        }
+        runTasks(id);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--running_ == 0) {
+                done_.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::runTasks(int id) {
+    int task;
+    while (popOwn(id, task) || steal(id, task)) {
+        try {
+            (*task_)(task);
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+            }
+            for (Range& range : ranges_) {
+                std::lock_guard<std::mutex> lock(range.mutex);
+                range.begin = range.end;
+            }
+        }
+    }
+}
+
+bool ThreadPool::popOwn(int id, int& task) {
+    Range& range = ranges_[id];
+    std::lock_guard<std::mutex> lock(range.mutex);
+    if (range.begin == range.end) {
+        return false;
+    }
+    task = range.begin++;
+    return true;
+}
+
+bool ThreadPool::steal(int id, int& task) {
+    for (int offset = 1; offset < size(); ++offset) {
+        Range& victim = ranges_[(id + offset) % size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.begin < victim.end) {
+            task = --victim.end;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,134 @@
+#include "tiling.h"
+#include "matrix_multiplication.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <initializer_list>
+#include <random>
+#include <unistd.h>
+
+namespace {
+
+long cacheSize(int name, long fallback) {
+    long size = sysconf(name);
+    return size > 0 ? size : fallback;
+}
+
+TileSizes& currentTiles() {
+    static TileSizes tiles = [] {
+        TileSizes t = defaultTileSizes();
+        loadTileSizes(tileConfigPath(), t);
+        return t;
+    }();
+    return tiles;
+}
+
+bool validTiles(const TileSizes& t) {
+    return t.mc > 0 && t.kc > 0 && t.nc > 0;
+}
+
+double timeKernel(ConstMatrixView<int> A, ConstMatrixView<int> B, MatrixView<int> C, const TileSizes& tiles) {
+    double best = 1e30;
+    for (int rep = 0; rep < 2; ++rep) {
+        auto start = std::chrono::steady_clock::now();
+        multiplyMatricesBlocked(A, B, C, tiles);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+} // namespace
+
+TileSizes defaultTileSizes() {
+    long l1 = cacheSize(_SC_LEVEL1_DCACHE_SIZE, 32 * 1024);
+    long l2 = cacheSize(_SC_LEVEL2_CACHE_SIZE, 1024 * 1024);
+    long l3 = cacheSize(_SC_LEVEL3_CACHE_SIZE, 8 * 1024 * 1024);
+
+    TileSizes t;
+    // A row segment of B and of C share L1
+    t.nc = static_cast<int>(std::clamp<long>(l1 / (4 * sizeof(int)), 64, 4096));
+    // Half of L2 holds the (kc x nc) panel of B
+    t.kc = static_cast<int>(std::clamp<long>(l2 / (2 * t.nc * sizeof(int)), 16, 1024));
+    // A quarter of L3 holds the blocks of A and C
+    t.mc = static_cast<int>(std::clamp<long>(l3 / (4 * (t.kc + t.nc) * sizeof(int)), 16, 1024));
+    return t;
+}
+
+TileSizes tileSizes() {
+    return currentTiles();
+}
+
+void setTileSizes(const TileSizes& tiles) {
+    if (validTiles(tiles)) {
+        currentTiles() = tiles;
+    }
+}
+
+std::string tileConfigPath() {
+    const char* path = std::getenv("MATMUL_TILE_CONFIG");
+    return path != nullptr && *path != '\0' ? path : "matmul_tiles.cfg";
+}
+
+bool loadTileSizes(const std::string& path, TileSizes& tiles) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+
+    TileSizes t = tiles;
+    std::string key;
+    int value;
+    while (in >> key >> value) {
+        if (key == "mc") {
+            t.mc = value;
+        } else if (key == "kc") {
+            t.kc = value;
+        } else if (key == "nc") {
+            t.nc = value;
+        }
+    }
+    if (!validTiles(t)) {
+        return false;
+    }
+    tiles = t;
+    return true;
+}
+
+bool saveTileSizes(const std::string& path, const TileSizes& tiles) {
+    std::ofstream out(path);
+    out << "mc " << tiles.mc << "\n"
+        << "kc " << tiles.kc << "\n"
+        << "nc " << tiles.nc << "\n";
+    return static_cast<bool>(out);
+}
+
+TileSizes autotuneTileSizes(int n) {
+    Matrix<int> A(n, n), B(n, n), C(n, n);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> dis(-100, 100);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            A(i, j) = dis(gen);
+            B(i, j) = dis(gen);
+        }
+    }
+
+    // Coordinate descent starting from the cache-size heuristic: tune nc, then kc, then mc
+    TileSizes best = defaultTileSizes();
+    double bestTime = timeKernel(A, B, C, best);
+    const int candidates[] = {16, 32, 64, 128, 256, 512, 1024, 2048};
+    for (int TileSizes::*field : {&TileSizes::nc, &TileSizes::kc, &TileSizes::mc}) {
+        for (int value : candidates) {
+            TileSizes trial = best;
+            trial.*field = value;
+            double t = timeKernel(A, B, C, trial);
+            if (t < bestTime) {
+                bestTime = t;
+                best = trial;
+            }
+        }
+    }
+    return best;
+}
@@ -1,6 +1,29 @@
+#include "batched.h"
+#include "chain.h"
+#include "distribution.h"
+#include "matrix_io.h"
 #include "matrix_multiplication.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "service.h"
+#include "sparse.h"
+#include "strassen.h"
+#include "structure.h"
+#include "thread_pool.h"
 #include <gtest/gtest.h>
+#include <mpi.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <climits>
+#include <fcntl.h>
+#include <fstream>
+#include <numeric>
 #include <random>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
 
 #define FUZZY_IT 50
 
@@ -20,6 +43,16 @@ void multiplyMatricesWithoutErrors(const std::vector<std::vector<int>> &A,
     }
 }
 
+// MPI for the tests of the distributed code, which run on MPI_COMM_SELF. Initialized on first
+// use only, so that the other tests do not pay for it; main finalizes it.
+void initMpi() {
+    int initialized;
+    MPI_Initialized(&initialized);
+    if (!initialized) {
+        MPI_Init(nullptr, nullptr);
+    }
+}
+
 // TESTS ON UNITARY-DIMENSION MATRICES ********************************************************
 // The following suite of tests wants to check various behaviour when the function is
 // required to perform a simple scalar multiplication
@@ -999,9 +1032,1497 @@ TEST(MatricesProperties, Distributive){
     ASSERT_EQ(AC_BC,A_B_C) << "Distributive test failed";
 }
 
+// TEST ON STRASSEN-WINOGRAD ********************************************************
+// The following tests want to check that the Strassen-Winograd recursion gives exactly the
+// same result of the classical product, also when the dimensions have to be padded
+
+/*
+ * Helper that multiplies random (aRows x aCols) * (aCols x bCols) matrices with
+ * multiplyStrassen and compares the result with multiplyMatricesWithoutErrors
+ */
+void checkStrassen(int aRows, int aCols, int bCols, int cutoff, std::mt19937& gen) {
+    std::uniform_int_distribution<> dis(-200, 200);
+    std::vector<std::vector<int>> A(aRows, std::vector<int>(aCols, 0));
+    std::vector<std::vector<int>> B(aCols, std::vector<int>(bCols, 0));
+    std::vector<std::vector<int>> expected(aRows, std::vector<int>(bCols, 0));
+    for (int i = 0; i < aRows; i++) {
+        for (int j = 0; j < aCols; j++) {
+            A[i][j] = dis(gen);
+        }
+    }
+    for (int i = 0; i < aCols; i++) {
+        for (int j = 0; j < bCols; j++) {
+            B[i][j] = dis(gen);
+        }
+    }
+    multiplyMatricesWithoutErrors(A, B, expected, aRows, aCols, bCols);
+
+    Matrix<int> a = Matrix<int>::fromNested(A, aRows, aCols);
+    Matrix<int> b = Matrix<int>::fromNested(B, aCols, bCols);
+    Matrix<int> c(aRows, bCols);
+    multiplyStrassen(a, b, c, cutoff);
+
+    EXPECT_EQ(c, Matrix<int>::fromNested(expected, aRows, bCols))
+            << "Strassen " << aRows << "x" << aCols << "x" << bCols << " with cutoff " << cutoff << " failed";
+}
+
+/*
+ * Square power-of-two matrices, halved evenly down to a leaf of 1, 2 or 8
+ */
+TEST(StrassenTests, PowerOfTwoTest) {
+    std::mt19937 gen(7);
+    for (int cutoff : {1, 2, 8}) {
+        checkStrassen(64, 64, 64, cutoff, gen);
+    }
+}
+
+/*
+ * Odd and rectangular dimensions, which need the zero padding
+ */
+TEST(StrassenTests, FuzzyTest) {
+    std::random_device rd;
+    for (int i = 0; i < FUZZY_IT; i++) {
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<> dim(1, 80);
+        std::uniform_int_distribution<> cut(1, 16);
+        checkStrassen(dim(gen), dim(gen), dim(gen), cut(gen), gen);
+    }
+}
+
+/*
+ * A workspace is reused by later products without growing, and an overflowing
+ * product wraps exactly like the classical kernel
+ */
+TEST(StrassenTests, WorkspaceAndOverflowTest) {
+    for (int n : {48, 33}) {
+        Matrix<int> A(n, n), B(n, n), C(n, n), expected(n, n);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                A(i, j) = 2000000000 - i * j;
+                B(i, j) = (i + 3 * j) % 17 - 8 + 100000 * (i == j);
+            }
+        }
+        multiplyMatrices(A, B, expected);
+
+        StrassenWorkspace workspace(n, n, n, 4);
+        std::size_t capacity = workspace.capacity();
+        for (int rep = 0; rep < 3; rep++) {
+            multiplyStrassen(A, B, C, 4, workspace);
+            EXPECT_EQ(C, expected) << "Strassen with a reused workspace failed for n = " << n;
+        }
+        EXPECT_EQ(workspace.capacity(), capacity) << "Workspace grew for n = " << n;
+    }
+}
+
+// TEST ON STRUCTURED MATRICES ********************************************************
+// The following tests want to check that zero, identity, diagonal and triangular inputs are
+// recognised, and that the kernels picked for them give the same result of the dense product
+
+/*
+ * Helper that builds a random (rows x cols) matrix with the given structure relative to the
+ * diagonal j == i + offset (General gives a dense matrix with a zero band of tiles)
+ */
+Matrix<int> randomStructured(int rows, int cols, Structure structure, int offset, std::mt19937& gen) {
+    std::uniform_int_distribution<> dis(-100, 100);
+    Matrix<int> m(rows, cols);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            const int d = i + offset;
+            int value = dis(gen);
+            switch (structure) {
+            case Structure::Zero:
+                value = 0;
+                break;
+            case Structure::Identity:
+                value = j == d ? 1 : 0;
+                break;
+            case Structure::Diagonal:
+                value = j == d ? value : 0;
+                break;
+            case Structure::UpperTriangular:
+                value = j >= d ? value : 0;
+                break;
+            case Structure::LowerTriangular:
+                value = j <= d ? value : 0;
+                break;
+            case Structure::General:
+                value = j / STRUCTURE_TILE == 1 ? 0 : value;
+                break;
+            }
+            m(i, j) = value;
+        }
+    }
+    return m;
+}
+
+/*
+ * The following test classifies square matrices and row blocks of them, where the
+ * diagonal is shifted by the first row of the block
+ */
+TEST(StructureTests, DetectTest) {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    for (Structure structure : {Structure::Zero, Structure::Identity, Structure::Diagonal, Structure::UpperTriangular,
+                                Structure::LowerTriangular}) {
+        Matrix<int> full = randomStructured(40, 40, structure, 0, gen);
+        for (int i = 0; i < 40; i++) {
+            if (full(i, i) == 0 && structure != Structure::Zero) {
+                full(i, i) = 1;
+            }
+        }
+        EXPECT_EQ(detectStructure<int>(full, 0), structure) << structureName(structure) << " not detected";
+        EXPECT_EQ(detectStructure<int>(full.block(15, 0, 10, 40), 15), structure)
+                << structureName(structure) << " row block not detected";
+    }
+
+    Matrix<int> dense = randomStructured(40, 40, Structure::UpperTriangular, 0, gen);
+    dense(30, 2) = 7;
+    EXPECT_EQ(detectStructure<int>(dense), Structure::General) << "Nonzeros on both sides must be general";
+
+    Matrix<int> identity = randomStructured(40, 40, Structure::Identity, 0, gen);
+    identity(3, 3) = 0;
+    EXPECT_EQ(detectStructure<int>(identity), Structure::Diagonal) << "A zero on the diagonal is not an identity";
+
+    ZeroTiles tiles = findZeroTiles<int>(randomStructured(3 * STRUCTURE_TILE, 3 * STRUCTURE_TILE,
+                                                          Structure::LowerTriangular, 0, gen));
+    EXPECT_EQ(tiles.count, 3) << "A lower triangular matrix of 3x3 tiles has 3 zero tiles";
+    EXPECT_TRUE(tiles(0, 2));
+    EXPECT_FALSE(tiles(2, 0));
+}
+
+/*
+ * The following test multiplies every pair of structures, with rectangular shapes and
+ * diagonal offsets, and compares the result with the dense product
+ */
+TEST(StructureTests, FuzzyTest) {
+    const Structure all[] = {Structure::General, Structure::Zero, Structure::Identity, Structure::Diagonal,
+                             Structure::UpperTriangular, Structure::LowerTriangular};
+    std::random_device rd;
+
+    for (int i = 0; i < FUZZY_IT / 10; i++) {
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<> dim(STRUCTURE_MIN_DIM, 3 * STRUCTURE_TILE);
+        std::uniform_int_distribution<> shift(-20, 20);
+        for (Structure a : all) {
+            for (Structure b : all) {
+                const int aRows = dim(gen), aCols = dim(gen), bCols = dim(gen);
+                const int offset = shift(gen);
+                Matrix<int> A = randomStructured(aRows, aCols, a, offset, gen);
+                Matrix<int> B = randomStructured(aCols, bCols, b, 0, gen);
+                Matrix<int> expected(aRows, bCols);
+                multiplyMatrices(A, B, expected);
+
+                Matrix<int> C(aRows, bCols);
+                if (multiplyStructured<int, int>(A, B, C, offset)) {
+                    EXPECT_EQ(C, expected) << structureName(a) << " x " << structureName(b) << " failed";
+                }
+            }
+        }
+    }
+
+    std::mt19937 gen(rd());
+    Matrix<int> dense = randomStructured(100, 100, Structure::General, 0, gen);
+    for (int i = 0; i < 100; i++) {
+        dense(i, STRUCTURE_TILE) = 1;
+    }
+    Matrix<int> C(100, 100);
+    EXPECT_FALSE((multiplyStructured<int, int>(dense, dense, C))) << "A dense product must use the usual kernel";
+}
+
+// TEST ON CONTIGUOUS MATRIX STORAGE ********************************************************
+// The following tests want to check the Matrix/MatrixView overload of the function,
+// which works on a single row-major buffer instead of nested vectors
+
+/*
+ * The following test checks that the contiguous overload agrees with the reference on random inputs
+ */
+TEST(ContiguousMatrixTests, FuzzyTest) {
+    std::random_device rd;
+
+    for (int i = 0; i < FUZZY_IT; i++) {
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<> dim(1, 40);
+        std::uniform_int_distribution<> dis(-200, 200);
+        int aRows = dim(gen);
+        int aCols = dim(gen);
+        int bCols = dim(gen);
+
+        std::vector<std::vector<int>> A(aRows, std::vector<int>(aCols, 0));
+        std::vector<std::vector<int>> B(aCols, std::vector<int>(bCols, 0));
+        std::vector<std::vector<int>> expected(aRows, std::vector<int>(bCols, 0));
+        for (int j = 0; j < aRows; j++) {
+            for (int k = 0; k < aCols; k++) {
+                A[j][k] = dis(gen);
+            }
+        }
+        for (int j = 0; j < aCols; j++) {
+            for (int k = 0; k < bCols; k++) {
+                B[j][k] = dis(gen);
+            }
+        }
+
+        Matrix<int> a = Matrix<int>::fromNested(A, aRows, aCols);
+        Matrix<int> b = Matrix<int>::fromNested(B, aCols, bCols);
+        Matrix<int> c(aRows, bCols);
+
+        multiplyMatrices(a, b, c);
+        multiplyMatricesWithoutErrors(A, B, expected, aRows, aCols, bCols);
+
+        EXPECT_EQ(c, Matrix<int>::fromNested(expected, aRows, bCols)) << "Contiguous fuzzy test iteration failed";
+    }
+}
+
+/*
+ * The following test checks that strided sub-block views are multiplied in place
+ */
+TEST(ContiguousMatrixTests, StridedViewTest) {
+    std::vector<std::vector<int>> A = {
+            {1, 2, 3, 4},
+            {5, 6, 7, 8},
+            {9, 10, 11, 12}
+    };
+    std::vector<std::vector<int>> B = {
+            {1, -1, 2},
+            {0, 3, -2},
+            {4, 1, 1},
+            {-3, 2, 0}
+    };
+
+    Matrix<int> a = Matrix<int>::fromNested(A, 3, 4);
+    Matrix<int> b = Matrix<int>::fromNested(B, 4, 3);
+    Matrix<int> c(5, 8, 16);
+
+    // (rows 1..2, cols 1..3 of A) * (rows 1..3, cols 0..1 of B) written at (2, 3) of C
+    multiplyMatrices(a.block(1, 1, 2, 3), b.block(1, 0, 3, 2), c.block(2, 3, 2, 2));
+
+    std::vector<std::vector<int>> subA = {{6, 7, 8}, {10, 11, 12}};
+    std::vector<std::vector<int>> subB = {{0, 3}, {4, 1}, {-3, 2}};
+    std::vector<std::vector<int>> expected(2, std::vector<int>(2, 0));
+    multiplyMatricesWithoutErrors(subA, subB, expected, 2, 3, 2);
+
+    for (int i = 0; i < c.rows(); ++i) {
+        for (int j = 0; j < c.cols(); ++j) {
+            bool inside = i >= 2 && i < 4 && j >= 3 && j < 5;
+            EXPECT_EQ(c(i, j), inside ? expected[i - 2][j - 3] : 0) << "Strided view test failed at " << i << "," << j;
+        }
+    }
+}
+
+/*
+ * The following test checks the blocked kernel with tile sizes that do not divide the matrix dimensions
+ */
+TEST(ContiguousMatrixTests, BlockedTilesTest) {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<> dis(-200, 200);
+
+    int aRows = 37;
+    int aCols = 29;
+    int bCols = 41;
+
+    std::vector<std::vector<int>> A(aRows, std::vector<int>(aCols, 0));
+    std::vector<std::vector<int>> B(aCols, std::vector<int>(bCols, 0));
+    std::vector<std::vector<int>> expected(aRows, std::vector<int>(bCols, 0));
+    for (int j = 0; j < aRows; j++) {
+        for (int k = 0; k < aCols; k++) {
+            A[j][k] = dis(gen);
+        }
+    }
+    for (int j = 0; j < aCols; j++) {
+        for (int k = 0; k < bCols; k++) {
+            B[j][k] = dis(gen);
+        }
+    }
+    multiplyMatricesWithoutErrors(A, B, expected, aRows, aCols, bCols);
+
+    Matrix<int> a = Matrix<int>::fromNested(A, aRows, aCols);
+    Matrix<int> b = Matrix<int>::fromNested(B, aCols, bCols);
+    for (TileSizes tiles : {TileSizes{1, 1, 1}, TileSizes{3, 5, 7}, TileSizes{16, 8, 32}, TileSizes{64, 64, 64}}) {
+        Matrix<int> c(aRows, bCols);
+        multiplyMatricesBlocked(a, b, c, tiles);
+        EXPECT_EQ(c, Matrix<int>::fromNested(expected, aRows, bCols))
+                << "Blocked test failed with mc=" << tiles.mc << " kc=" << tiles.kc << " nc=" << tiles.nc;
+    }
+}
+
+// TEST ON SIMD MICRO-KERNELS ********************************************************
+// The following tests want to check that every instruction set path of the kernel
+// supported by the host gives exactly the same result as the reference implementation
+
+/*
+ * The following test forces each supported instruction set and cross-checks random matrices
+ * whose dimensions are not multiples of the register tile
+ */
+TEST(SimdKernelTests, ExactnessTest) {
+    const Isa original = activeIsa();
+    std::random_device rd;
+
+    for (Isa isa : {Isa::Scalar, Isa::Avx2, Isa::Avx512}) {
+        if (!setIsa(isa)) {
+            continue;
+        }
+        for (int i = 0; i < FUZZY_IT; i++) {
+            std::mt19937 gen(rd());
+            std::uniform_int_distribution<> dim(1, 70);
+            std::uniform_int_distribution<> dis(-200, 200);
+            int aRows = dim(gen);
+            int aCols = dim(gen);
+            int bCols = dim(gen);
+
+            std::vector<std::vector<int>> A(aRows, std::vector<int>(aCols, 0));
+            std::vector<std::vector<int>> B(aCols, std::vector<int>(bCols, 0));
+            std::vector<std::vector<int>> C(aRows, std::vector<int>(bCols, 0));
+            std::vector<std::vector<int>> expected(aRows, std::vector<int>(bCols, 0));
+            for (int j = 0; j < aRows; j++) {
+                for (int k = 0; k < aCols; k++) {
+                    A[j][k] = dis(gen);
+                }
+            }
+            for (int j = 0; j < aCols; j++) {
+                for (int k = 0; k < bCols; k++) {
+                    B[j][k] = dis(gen);
+                }
+            }
+
+            multiplyMatrices(A, B, C, aRows, aCols, bCols);
+            multiplyMatricesWithoutErrors(A, B, expected, aRows, aCols, bCols);
+
+            EXPECT_EQ(C, expected) << "SIMD exactness test failed for " << isaName(isa) << " on "
+                                   << aRows << "x" << aCols << "x" << bCols;
+        }
+    }
+    setIsa(original);
+}
+
+// TEST ON MULTITHREADED KERNEL ********************************************************
+// The following tests want to check the thread pool that shares the tiles of C out
+// among threads, and the multiplication running on top of it
+
+/*
+ * The following test checks that every task index is run exactly once, also when some
+ * threads finish early and steal from the others
+ */
+TEST(ThreadPoolTests, CoverageTest) {
+    ThreadPool pool(4, false);
+    for (int count : {0, 1, 3, 4, 97, 1000}) {
+        std::vector<std::atomic<int>> hits(count);
+        pool.parallelFor(count, [&](int i) {
+            if (i % 7 == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            hits[i]++;
+        });
+        for (int i = 0; i < count; i++) {
+            EXPECT_EQ(hits[i].load(), 1) << "Task " << i << " of " << count << " not run exactly once";
+        }
+    }
+}
+
+/*
+ * The following test throws from tasks on the caller and on the workers: the first exception
+ * reaches the caller once every thread has stopped, and the pool keeps working afterwards
+ */
+TEST(ThreadPoolTests, ExceptionTest) {
+    ThreadPool pool(4, false);
+    for (int thrower : {0, 50, 99}) {
+        EXPECT_THROW(pool.parallelFor(100,
+                                      [&](int i) {
+                                          if (i == thrower) {
+                                              throw std::runtime_error("task failed");
+                                          }
+                                      }),
+                     std::runtime_error)
+            << "Exception of task " << thrower << " lost";
+    }
+    std::vector<std::atomic<int>> hits(100);
+    pool.parallelFor(100, [&](int i) { hits[i]++; });
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(hits[i].load(), 1) << "Task " << i << " after an exception";
+    }
+}
+
+/*
+ * The following test calls parallelFor from inside tasks: the inner loops run serially on
+ * their thread and leave the outer loop intact
+ */
+TEST(ThreadPoolTests, NestedTest) {
+    ThreadPool pool(4, false);
+    std::vector<std::atomic<int>> hits(16 * 16);
+    pool.parallelFor(16, [&](int i) { pool.parallelFor(16, [&](int j) { hits[i * 16 + j]++; }); });
+    for (int i = 0; i < 16 * 16; i++) {
+        EXPECT_EQ(hits[i].load(), 1) << "Nested task " << i << " not run exactly once";
+    }
+}
+
+/*
+ * The following test multiplies random matrices on a 4-thread pool and cross-checks the result
+ */
+TEST(ThreadPoolTests, FuzzyTest) {
+    const int threads = ThreadPool::global().size();
+    ThreadPool::setThreads(4, false);
+    std::random_device rd;
+
+    for (int i = 0; i < FUZZY_IT; i++) {
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<> dim(1, 90);
+        std::uniform_int_distribution<> dis(-200, 200);
+        int aRows = dim(gen);
+        int aCols = dim(gen);
+        int bCols = dim(gen);
+
+        std::vector<std::vector<int>> A(aRows, std::vector<int>(aCols, 0));
+        std::vector<std::vector<int>> B(aCols, std::vector<int>(bCols, 0));
+        std::vector<std::vector<int>> C(aRows, std::vector<int>(bCols, 0));
+        std::vector<std::vector<int>> expected(aRows, std::vector<int>(bCols, 0));
+        for (int j = 0; j < aRows; j++) {
+            for (int k = 0; k < aCols; k++) {
+                A[j][k] = dis(gen);
+            }
+        }
+        for (int j = 0; j < aCols; j++) {
+            for (int k = 0; k < bCols; k++) {
+                B[j][k] = dis(gen);
+            }
+        }
+
+        multiplyMatrices(A, B, C, aRows, aCols, bCols);
+        multiplyMatricesWithoutErrors(A, B, expected, aRows, aCols, bCols);
+
+        EXPECT_EQ(C, expected) << "Multithreaded fuzzy test iteration failed";
+    }
+    // The later tests run on the pool of $MATMUL_THREADS again
+    ThreadPool::setThreads(threads, false);
+}
+
+// TEST ON ELEMENT TYPES ********************************************************
+// The following tests want to check the multiplication on every supported pair of
+// element type and accumulator type, with every instruction set of the host
+
+/*
+ * Helper that multiplies random (aRows x aCols) * (aCols x bCols) matrices of T, with
+ * values in [lo, hi], accumulating in Acc, and compares the result with a plain triple
+ * loop computed in long double (exact for every value used here)
+ */
+template <typename T, typename Acc>
+void checkElementType(int aRows, int aCols, int bCols, long long lo, long long hi, std::mt19937& gen) {
+    std::uniform_int_distribution<long long> dis(lo, hi);
+    Matrix<T> A(aRows, aCols), B(aCols, bCols);
+    Matrix<Acc> C(aRows, bCols);
+    for (int i = 0; i < aRows; i++) {
+        for (int j = 0; j < aCols; j++) {
+            A(i, j) = static_cast<T>(dis(gen));
+        }
+    }
+    for (int i = 0; i < aCols; i++) {
+        for (int j = 0; j < bCols; j++) {
+            B(i, j) = static_cast<T>(dis(gen));
+        }
+    }
+
+    multiplyMatrices<T, Acc>(A, B, C);
+
+    for (int i = 0; i < aRows; i++) {
+        for (int j = 0; j < bCols; j++) {
+            long double expected = 0;
+            for (int k = 0; k < aCols; k++) {
+                expected += static_cast<long double>(A(i, k)) * static_cast<long double>(B(k, j));
+            }
+            ASSERT_EQ(static_cast<long double>(C(i, j)), expected)
+                    << "Element (" << i << ", " << j << ") of a " << aRows << "x" << aCols << "x" << bCols
+                    << " product is wrong";
+        }
+    }
+}
+
+/*
+ * int8 and int16 inputs near the ends of their range: the sums overflow the input type,
+ * but not the accumulator (int16 x int16 sums only fit int32 for moderate values)
+ */
+TEST(ElementTypeTests, NarrowInputsTest) {
+    const Isa original = activeIsa();
+    std::random_device rd;
+
+    for (Isa isa : {Isa::Scalar, Isa::Avx2, Isa::Avx512}) {
+        if (!setIsa(isa)) {
+            continue;
+        }
+        for (int i = 0; i < FUZZY_IT / 5; i++) {
+            std::mt19937 gen(rd());
+            std::uniform_int_distribution<> dim(1, 70);
+            checkElementType<std::int8_t, std::int32_t>(dim(gen), dim(gen), dim(gen), -128, 127, gen);
+            checkElementType<std::int8_t, std::int64_t>(dim(gen), dim(gen), dim(gen), -128, 127, gen);
+            checkElementType<std::int16_t, std::int32_t>(dim(gen), dim(gen), dim(gen), -5000, 5000, gen);
+            checkElementType<std::int16_t, std::int64_t>(dim(gen), dim(gen), dim(gen), -32768, 32767, gen);
+        }
+    }
+    setIsa(original);
+}
+
+/*
+ * int32 inputs whose products overflow int32 are exact with an int64 accumulator, and so
+ * are int64 inputs
+ */
+TEST(ElementTypeTests, WideAccumulatorTest) {
+    const Isa original = activeIsa();
+    std::random_device rd;
+
+    for (Isa isa : {Isa::Scalar, Isa::Avx2, Isa::Avx512}) {
+        if (!setIsa(isa)) {
+            continue;
+        }
+        for (int i = 0; i < FUZZY_IT / 5; i++) {
+            std::mt19937 gen(rd());
+            std::uniform_int_distribution<> dim(1, 70);
+            checkElementType<std::int32_t, std::int64_t>(dim(gen), dim(gen), dim(gen), -2000000, 2000000, gen);
+            checkElementType<std::int64_t, std::int64_t>(dim(gen), dim(gen), dim(gen), -2000000, 2000000, gen);
+        }
+    }
+    setIsa(original);
+}
+
+/*
+ * Floating-point inputs holding small integers, whose products and sums are exact
+ */
+TEST(ElementTypeTests, FloatingPointTest) {
+    const Isa original = activeIsa();
+    std::random_device rd;
+
+    for (Isa isa : {Isa::Scalar, Isa::Avx2, Isa::Avx512}) {
+        if (!setIsa(isa)) {
+            continue;
+        }
+        for (int i = 0; i < FUZZY_IT / 5; i++) {
+            std::mt19937 gen(rd());
+            std::uniform_int_distribution<> dim(1, 70);
+            checkElementType<float, float>(dim(gen), dim(gen), dim(gen), -100, 100, gen);
+            checkElementType<float, double>(dim(gen), dim(gen), dim(gen), -100000, 100000, gen);
+            checkElementType<double, double>(dim(gen), dim(gen), dim(gen), -100000, 100000, gen);
+        }
+    }
+    setIsa(original);
+}
+
+// TEST ON SPARSE MATRICES ********************************************************
+// The following tests want to check the CSR/CSC conversions and that every sparse kernel
+// gives exactly the same result of the dense product
+
+/*
+ * Helper that fills a (rows x cols) matrix with values in [-50, 50], keeping each element
+ * nonzero with probability `fill`
+ */
+Matrix<int> randomSparse(int rows, int cols, double fill, std::mt19937& gen) {
+    std::uniform_int_distribution<> dis(-50, 50);
+    std::bernoulli_distribution keep(fill);
+    Matrix<int> m(rows, cols);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            if (keep(gen)) {
+                m(i, j) = dis(gen);
+            }
+        }
+    }
+    return m;
+}
+
+/*
+ * The following test converts random matrices to CSR and CSC and back, and builds the
+ * same CSR matrix from shuffled triplets
+ */
+TEST(SparseTests, ConversionTest) {
+    std::random_device rd;
+
+    for (int i = 0; i < FUZZY_IT / 5; i++) {
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<> dim(1, 60);
+        Matrix<int> dense = randomSparse(dim(gen), dim(gen), 0.1, gen);
+
+        CsrMatrix<int> csr = toCsr<int>(dense);
+        EXPECT_EQ(toDense(csr), dense) << "CSR round trip failed";
+        CscMatrix<int> csc = toCsc(csr);
+        ASSERT_EQ(csc.nnz(), csr.nnz());
+        for (int j = 0; j < csc.cols; j++) {
+            for (int p = csc.colPtr[j]; p < csc.colPtr[j + 1]; p++) {
+                EXPECT_EQ(csc.values[p], dense(csc.rowIdx[p], j)) << "CSC element is wrong";
+            }
+        }
+
+        std::vector<int> rowIndex, colIndex, values;
+        for (int r = 0; r < dense.rows(); r++) {
+            for (int c = 0; c < dense.cols(); c++) {
+                if (dense(r, c) != 0) {
+                    rowIndex.push_back(r);
+                    colIndex.push_back(c);
+                    values.push_back(dense(r, c));
+                }
+            }
+        }
+        std::vector<int> order(values.size());
+        for (std::size_t k = 0; k < order.size(); k++) {
+            order[k] = static_cast<int>(k);
+        }
+        std::shuffle(order.begin(), order.end(), gen);
+        std::vector<int> shuffledRows, shuffledCols, shuffledValues;
+        for (int k : order) {
+            shuffledRows.push_back(rowIndex[k]);
+            shuffledCols.push_back(colIndex[k]);
+            shuffledValues.push_back(values[k]);
+        }
+        CsrMatrix<int> built = csrFromTriplets(dense.rows(), dense.cols(), shuffledRows, shuffledCols, shuffledValues);
+        EXPECT_EQ(built.rowPtr, csr.rowPtr) << "Triplet build gave different row pointers";
+        EXPECT_EQ(built.colIdx, csr.colIdx) << "Triplet build gave different column indices";
+        EXPECT_EQ(built.values, csr.values) << "Triplet build gave different values";
+    }
+}
+
+/*
+ * The following test multiplies random matrices of several densities (including empty rows
+ * and an all-zero matrix) with SpMM, dense x sparse and SpGEMM
+ */
+TEST(SparseTests, FuzzyTest) {
+    std::random_device rd;
+
+    for (int i = 0; i < FUZZY_IT / 5; i++) {
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<> dim(1, 80);
+        for (double fill : {0.0, 0.02, 0.2, 1.0}) {
+            const int aRows = dim(gen), aCols = dim(gen), bCols = dim(gen);
+            Matrix<int> A = randomSparse(aRows, aCols, fill, gen);
+            Matrix<int> B = randomSparse(aCols, bCols, fill, gen);
+            Matrix<int> expected(aRows, bCols);
+            multiplyMatrices(A, B, expected);
+
+            Matrix<int> C(aRows, bCols);
+            multiplySparseDense<int, int>(toCsr<int>(A), B, C);
+            EXPECT_EQ(C, expected) << "SpMM failed with density " << fill;
+
+            Matrix<int> D(aRows, bCols);
+            multiplyDenseSparse<int, int>(A, toCsc(toCsr<int>(B)), D);
+            EXPECT_EQ(D, expected) << "Dense x sparse failed with density " << fill;
+
+            CsrMatrix<int> S = multiplySparse<int, int>(toCsr<int>(A), toCsr<int>(B));
+            EXPECT_EQ(toDense(S), expected) << "SpGEMM failed with density " << fill;
+        }
+    }
+}
+
+// TEST ON VECTOR SHAPES ********************************************************
+// The following tests want to check the matrix-vector, vector-matrix and outer product
+// kernels picked when one of the dimensions is 1, with every instruction set of the host
+
+/*
+ * Every vector shape, including lengths that leave a tail after the vectors of each ISA
+ */
+TEST(VectorShapeTests, FuzzyTest) {
+    const Isa original = activeIsa();
+    std::random_device rd;
+
+    for (Isa isa : {Isa::Scalar, Isa::Avx2, Isa::Avx512}) {
+        if (!setIsa(isa)) {
+            continue;
+        }
+        for (int i = 0; i < FUZZY_IT / 5; i++) {
+            std::mt19937 gen(rd());
+            std::uniform_int_distribution<> dim(1, 300);
+            const int m = dim(gen), k = dim(gen), n = dim(gen);
+            checkElementType<std::int32_t, std::int32_t>(m, k, 1, -1000, 1000, gen);
+            checkElementType<std::int32_t, std::int32_t>(1, k, n, -1000, 1000, gen);
+            checkElementType<std::int32_t, std::int32_t>(m, 1, n, -1000, 1000, gen);
+            checkElementType<std::int8_t, std::int32_t>(m, k, 1, -128, 127, gen);
+            checkElementType<std::int16_t, std::int64_t>(1, k, n, -32768, 32767, gen);
+            checkElementType<float, double>(m, 1, n, -1000, 1000, gen);
+            checkElementType<double, double>(m, k, 1, -1000, 1000, gen);
+        }
+    }
+    setIsa(original);
+}
+
+/*
+ * multiplyAccumulate adds the vector products to C, also on strided views
+ */
+TEST(VectorShapeTests, AccumulateTest) {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<> dis(-100, 100);
+    const int m = 37, k = 45, n = 29;
+
+    Matrix<int> storageA(m, k + 3), storageB(k, n + 5), storageC(m, n + 2);
+    for (Matrix<int>* storage : {&storageA, &storageB, &storageC}) {
+        for (int i = 0; i < storage->rows(); i++) {
+            for (int j = 0; j < storage->cols(); j++) {
+                (*storage)(i, j) = dis(gen);
+            }
+        }
+    }
+    // (m x k) * (k x 1), (1 x k) * (k x n) and (m x 1) * (1 x n) products
+    const int shapes[3][3] = {{m, k, 1}, {1, k, n}, {m, 1, n}};
+    for (const auto& shape : shapes) {
+        ConstMatrixView<int> A = storageA.block(0, 0, shape[0], shape[1]);
+        ConstMatrixView<int> B = storageB.block(0, 0, shape[1], shape[2]);
+        MatrixView<int> C = storageC.block(0, 0, shape[0], shape[2]);
+
+        Matrix<int> expected(shape[0], shape[2]);
+        for (int i = 0; i < shape[0]; i++) {
+            for (int j = 0; j < shape[2]; j++) {
+                expected(i, j) = C(i, j);
+                for (int p = 0; p < shape[1]; p++) {
+                    expected(i, j) += A(i, p) * B(p, j);
+                }
+            }
+        }
+        multiplyAccumulate(A, B, C);
+        for (int i = 0; i < shape[0]; i++) {
+            for (int j = 0; j < shape[2]; j++) {
+                ASSERT_EQ(C(i, j), expected(i, j)) << shape[0] << "x" << shape[1] << "x" << shape[2] << " accumulate failed";
+            }
+        }
+    }
+}
+
+// TEST ON BATCHED MULTIPLICATION ********************************************************
+// The following tests want to check that every product of a batch matches the single
+// multiplication, for the unrolled sizes and the others, in strided and pointer-array form
+
+/*
+ * Helper that multiplies a random batch of (m x k) * (k x n) products, stored with padded
+ * rows and gaps between the matrices, and compares each one with multiplyMatrices
+ */
+template <typename T, typename Acc>
+void checkBatched(int count, int m, int k, int n, std::mt19937& gen) {
+    std::uniform_int_distribution<> dis(-100, 100);
+    const int pad = 3;
+    const std::ptrdiff_t strideA = static_cast<std::ptrdiff_t>(m) * (k + pad) + pad;
+    const std::ptrdiff_t strideB = static_cast<std::ptrdiff_t>(k) * (n + pad) + pad;
+    const std::ptrdiff_t strideC = static_cast<std::ptrdiff_t>(m) * (n + pad) + pad;
+    std::vector<T> a(count * strideA), b(count * strideB);
+    std::vector<Acc> c(count * strideC);
+    for (T& x : a) {
+        x = static_cast<T>(dis(gen));
+    }
+    for (T& x : b) {
+        x = static_cast<T>(dis(gen));
+    }
+
+    StridedBatch<const T> A(a.data(), count, m, k, k + pad, strideA);
+    StridedBatch<const T> B(b.data(), count, k, n, n + pad, strideB);
+    StridedBatch<Acc> C(c.data(), count, m, n, n + pad, strideC);
+    multiplyBatched<T, Acc>(A, B, C);
+
+    for (int q = 0; q < count; q++) {
+        Matrix<Acc> expected(m, n);
+        multiplyMatrices<T, Acc>(A[q], B[q], expected);
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < n; j++) {
+                ASSERT_EQ(C[q](i, j), expected(i, j))
+                        << "Product " << q << " of a batch of " << m << "x" << k << "x" << n << " is wrong";
+            }
+        }
+    }
+}
+
+/*
+ * Unrolled square sizes and random shapes, on every instruction set of the host
+ */
+TEST(BatchedTests, StridedTest) {
+    const Isa original = activeIsa();
+    std::random_device rd;
+
+    for (Isa isa : {Isa::Scalar, Isa::Avx2, Isa::Avx512}) {
+        if (!setIsa(isa)) {
+            continue;
+        }
+        std::mt19937 gen(rd());
+        for (int size : {4, 8, 16}) {
+            checkBatched<int, int>(50, size, size, size, gen);
+            checkBatched<std::int8_t, std::int32_t>(20, size, size, size, gen);
+            checkBatched<float, double>(20, size, size, size, gen);
+        }
+        // Every rectangular shape with an unrolled kernel
+        for (int m : {4, 8, 16}) {
+            for (int k : {4, 8, 16}) {
+                for (int n : {4, 8, 16}) {
+                    checkBatched<int, int>(10, m, k, n, gen);
+                    checkBatched<float, double>(10, m, k, n, gen);
+                }
+            }
+        }
+        std::uniform_int_distribution<> dim(1, 40);
+        for (int i = 0; i < FUZZY_IT / 10; i++) {
+            checkBatched<int, int>(dim(gen), dim(gen), dim(gen), dim(gen), gen);
+            checkBatched<std::int16_t, std::int64_t>(dim(gen), dim(gen), dim(gen), dim(gen), gen);
+        }
+    }
+    setIsa(original);
+}
+
+/*
+ * Pointer arrays whose matrices are scattered through a buffer in reverse order
+ */
+TEST(BatchedTests, PointerArrayTest) {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<> dis(-100, 100);
+    const int count = 64;
+
+    for (int size : {8, 13}) {
+        const int elements = size * size;
+        std::vector<int> storageA(count * elements), storageB(count * elements), storageC(count * elements);
+        for (int i = 0; i < count * elements; i++) {
+            storageA[i] = dis(gen);
+            storageB[i] = dis(gen);
+        }
+        std::vector<const int*> A(count), B(count);
+        std::vector<int*> C(count);
+        for (int q = 0; q < count; q++) {
+            A[q] = storageA.data() + (count - 1 - q) * elements;
+            B[q] = storageB.data() + q * elements;
+            C[q] = storageC.data() + (count - 1 - q) * elements;
+        }
+        multiplyBatched<int, int>(A.data(), B.data(), C.data(), count, size, size, size);
+
+        for (int q = 0; q < count; q++) {
+            Matrix<int> expected(size, size);
+            multiplyMatrices(ConstMatrixView<int>(A[q], size, size), ConstMatrixView<int>(B[q], size, size), expected);
+            EXPECT_TRUE(std::equal(C[q], C[q] + elements, expected.data()))
+                    << "Product " << q << " of the " << size << "x" << size << " pointer batch is wrong";
+        }
+    }
+}
+
+// TEST ON MATRIX CHAINS ********************************************************
+// The following tests want to check the order picked for a chain of products, and that the
+// chain evaluated in that order gives the same result of the left-to-right products
+
+/*
+ * The textbook chain of six factors (Cormen et al.), whose best order is known
+ */
+TEST(ChainTests, PlanTest) {
+    ChainPlan plan({30, 35, 15, 5, 10, 20, 25});
+    EXPECT_EQ(plan.cost(), 15125) << "Wrong optimal cost";
+    EXPECT_EQ(plan.toString(), "((A0 (A1 A2)) ((A3 A4) A5))") << "Wrong optimal order";
+    EXPECT_EQ(plan.leftToRightCost(), 40500) << "Wrong left-to-right cost";
+
+    ChainPlan vector({500, 500, 500, 1});
+    EXPECT_EQ(vector.toString(), "(A0 (A1 A2))") << "A chain ending in a vector must be multiplied from the right";
+    EXPECT_THROW(ChainPlan({4}), std::invalid_argument) << "A chain without factors was accepted";
+}
+
+/*
+ * Random chains of 1 to 6 factors, checked against the left-to-right products; the same
+ * pool is then reused for the same chain without allocating again
+ */
+TEST(ChainTests, FuzzyTest) {
+    std::random_device rd;
+
+    for (int i = 0; i < FUZZY_IT / 5; i++) {
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<> dis(-10, 10);
+        std::uniform_int_distribution<> dim(1, 40);
+        std::uniform_int_distribution<> length(1, 6);
+
+        std::vector<int> dims(length(gen) + 1);
+        for (int& d : dims) {
+            d = dim(gen);
+        }
+        std::vector<Matrix<int>> factors;
+        std::vector<ConstMatrixView<int>> views;
+        for (std::size_t f = 0; f + 1 < dims.size(); f++) {
+            factors.emplace_back(dims[f], dims[f + 1]);
+            for (int r = 0; r < dims[f]; r++) {
+                for (int c = 0; c < dims[f + 1]; c++) {
+                    factors.back()(r, c) = dis(gen);
+                }
+            }
+        }
+        for (const Matrix<int>& factor : factors) {
+            views.push_back(factor);
+        }
+
+        Matrix<int> expected = factors[0];
+        for (std::size_t f = 1; f < factors.size(); f++) {
+            Matrix<int> next(expected.rows(), factors[f].cols());
+            multiplyMatrices(expected, factors[f], next);
+            expected = std::move(next);
+        }
+        EXPECT_EQ(multiplyChain(views), expected) << "Chain of " << factors.size() << " factors failed";
+
+        ChainPlan plan(dims);
+        MatrixPool<int> pool;
+        Matrix<int> C(dims.front(), dims.back());
+        multiplyChain(views, plan, C.view(), pool);
+        const std::size_t buffers = pool.buffers();
+        EXPECT_LE(buffers, factors.size()) << "Too many intermediate buffers";
+        multiplyChain(views, plan, C.view(), pool);
+        EXPECT_EQ(pool.buffers(), buffers) << "A reused pool allocated again";
+        EXPECT_EQ(C, expected) << "Chain with a reused pool failed";
+    }
+}
+
+// TEST ON SERVICE MODE ********************************************************
+// The following tests want to check the cache of B kept between the jobs of the service,
+// and the requests and replies exchanged with its clients
+
+/*
+ * Least recently used matrices leave first, element types are told apart, and a matrix
+ * larger than the whole cache is never stored
+ */
+TEST(ServiceTests, CacheTest) {
+    const std::size_t bytes = 16 * 16 * sizeof(int);
+    MatrixCache cache(2 * bytes);
+    auto matrix = [](int value) {
+        auto m = std::make_shared<Matrix<int>>(16, 16);
+        std::fill_n(m->data(), m->size(), value);
+        return std::shared_ptr<const Matrix<int>>(m);
+    };
+
+    cache.insert("a", matrix(1));
+    cache.insert("b", matrix(2));
+    ASSERT_NE(cache.find<int>("a"), nullptr) << "Cached matrix not found";
+    EXPECT_EQ((*cache.find<int>("a"))(3, 3), 1) << "Wrong cached matrix";
+    EXPECT_EQ(cache.find<float>("a"), nullptr) << "Matrix found with another element type";
+
+    cache.insert("c", matrix(3));
+    EXPECT_EQ(cache.find<int>("b"), nullptr) << "The least recently used matrix was not evicted";
+    EXPECT_NE(cache.find<int>("a"), nullptr) << "A recently used matrix was evicted";
+    EXPECT_EQ(cache.matrices(), 2u);
+    EXPECT_EQ(cache.bytes(), 2 * bytes);
+
+    cache.insert("big", std::make_shared<const Matrix<int>>(64, 64));
+    EXPECT_EQ(cache.peek<int>("big"), nullptr) << "A matrix larger than the cache was stored";
+    EXPECT_EQ(cache.matrices(), 2u) << "A matrix larger than the cache evicted others";
+    EXPECT_EQ(cache.hits(), 3u);
+    EXPECT_EQ(cache.misses(), 2u);
+}
+
+/*
+ * Requests and replies sent over a socket pair arrive unchanged, including an empty request,
+ * and a request cut short fails once the read timeout runs out
+ */
+TEST(ServiceTests, RequestTest) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    const std::vector<std::string> args = {"--a", "/data/A matrix.bin", "--b", "B.txt", "--output", "C.txt"};
+    writeRequest(fds[0], args);
+    EXPECT_EQ(readRequest(fds[1]), args) << "Request changed on the way";
+    writeReply(fds[1], "ok 0.5 s");
+    EXPECT_EQ(readReply(fds[0]), "ok 0.5 s") << "Reply changed on the way";
+
+    writeRequest(fds[0], {});
+    EXPECT_TRUE(readRequest(fds[1]).empty()) << "Empty request not recognised";
+    EXPECT_THROW(writeRequest(fds[0], {"two\nlines"}), std::runtime_error);
+
+    setReadTimeout(fds[1], 50);
+    ASSERT_EQ(write(fds[0], "--a\n", 4), 4);
+    EXPECT_THROW(readRequest(fds[1]), std::runtime_error) << "Unfinished request read without a timeout";
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// TEST ON PROFILING ********************************************************
+// The following tests want to check that the profiled regions count every call once,
+// nested ones included, and only while profiling is on
+
+/*
+ * A product counts one multiply call with its 2 M N K operations, even though the kernel
+ * nests multiplyAccumulate inside multiplyMatrices; nothing is recorded once profiling is off
+ */
+TEST(ProfileTests, RegionTest) {
+#ifndef MATMUL_PROFILE
+    GTEST_SKIP() << "Built without MATMUL_PROFILE";
+#endif
+    Matrix<int> A(32, 16), B(16, 8), C(32, 8);
+    std::fill_n(A.data(), A.size(), 1);
+    std::fill_n(B.data(), B.size(), 2);
+
+    setProfiling(true);
+    multiplyMatrices<int, int>(A, B, C);
+    {
+        ProfileScope outer(Region::Read);
+        ProfileScope inner(Region::Read);
+    }
+    RegionProfile multiply = regionProfile(Region::Multiply);
+    EXPECT_EQ(multiply.calls, 1u) << "Nested multiply counted more than once";
+    EXPECT_EQ(multiply.operations, 2.0 * 32 * 16 * 8);
+    EXPECT_GE(multiply.seconds, 0.0);
+    EXPECT_EQ(regionProfile(Region::Read).calls, 1u) << "Nested scope counted more than once";
+    EXPECT_EQ(regionProfile(Region::Broadcast).calls, 0u);
+
+    ProfileSummary summary;
+    summary.ranks = 1;
+    summary.total[static_cast<int>(Region::Multiply)] = multiply;
+    summary.maxSeconds[static_cast<int>(Region::Multiply)] = 0.5;
+    const std::string line = profileLine(summary);
+    EXPECT_NE(line.find("multiply 0.500000 s x1"), std::string::npos) << line;
+    EXPECT_EQ(line.find("read"), std::string::npos) << "Region without calls in the summary: " << line;
+
+    setProfiling(false);
+    multiplyMatrices<int, int>(A, B, C);
+    EXPECT_EQ(regionProfile(Region::Multiply).calls, 0u) << "Recorded with profiling off";
+}
+
+/*
+ * While tracing, a product records one multiply event on the calling thread enclosing
+ * one tile event per tile of C, and no region totals unless profiling is on too
+ */
+TEST(ProfileTests, TraceTest) {
+#ifndef MATMUL_PROFILE
+    GTEST_SKIP() << "Built without MATMUL_PROFILE";
+#endif
+    const TileSizes tiles{16, 16, 16};
+    Matrix<int> A(48, 32), B(32, 40), C(48, 40);
+    std::fill_n(A.data(), A.size(), 1);
+    std::fill_n(B.data(), B.size(), 1);
+
+    setTracing(true);
+    multiplyMatricesBlocked<int, int>(A, B, C, tiles);
+    const std::vector<TraceEvent> events = traceEvents();
+    setTracing(false);
+
+    const auto multiply = std::find_if(events.begin(), events.end(), [](const TraceEvent& e) {
+        return e.name == static_cast<int>(Region::Multiply);
+    });
+    ASSERT_NE(multiply, events.end()) << "No multiply event";
+    EXPECT_EQ(multiply->thread, 0) << "Multiply not on the thread that started the trace";
+    EXPECT_EQ(std::count_if(events.begin(), events.end(),
+                            [](const TraceEvent& e) { return e.name == static_cast<int>(Region::Multiply); }),
+              1) << "Nested multiply traced more than once";
+
+    int tileEvents = 0;
+    for (const TraceEvent& e : events) {
+        if (e.name == TRACE_TILE) {
+            ++tileEvents;
+            EXPECT_LE(e.begin, e.end);
+            EXPECT_GE(e.begin, multiply->begin) << "Tile outside its multiply";
+            EXPECT_LE(e.end, multiply->end) << "Tile outside its multiply";
+        }
+    }
+    // With more pool threads the tiles get shorter, so there are at least 3 x 3 of them
+    EXPECT_GE(tileEvents, 3 * 3) << "Expected one event per tile of C";
+    EXPECT_EQ(regionProfile(Region::Multiply).calls, 0u) << "Region totals recorded without profiling";
+    EXPECT_TRUE(traceEvents().empty()) << "Events kept after tracing was turned off";
+}
+
+// TEST ON DATA DISTRIBUTION ********************************************************
+// The following tests want to check the arithmetic of the splits of the distributed product
+// and that the MPI datatypes built from it select exactly the elements of a rank
+
+// Elements of `m` that one item of `type` selects, in order
+std::vector<int> selectedElements(const Matrix<int> &m, MPI_Datatype type) {
+    int bytes;
+    MPI_Type_size(type, &bytes);
+    int packed;
+    MPI_Pack_size(1, type, MPI_COMM_SELF, &packed);
+    std::vector<char> buffer(packed);
+    int position = 0;
+    MPI_Pack(m.data(), 1, type, buffer.data(), packed, &position, MPI_COMM_SELF);
+    std::vector<int> values(bytes / sizeof(int));
+    position = 0;
+    MPI_Unpack(buffer.data(), packed, &position, values.data(), static_cast<int>(values.size()), MPI_INT,
+               MPI_COMM_SELF);
+    return values;
+}
+
+/*
+ * Row blocks differ by at most one row, follow each other in order and cover every row;
+ * with more ranks than rows the trailing ranks get none
+ */
+TEST(DistributionTests, RowPartitionTest) {
+    RowPartition p = RowPartition::balanced(10, 4);
+    EXPECT_EQ(p.counts, (std::vector<int>{3, 3, 2, 2}));
+    EXPECT_EQ(p.offsets, (std::vector<int>{0, 3, 6, 8}));
+    RowPartition few = RowPartition::balanced(2, 5);
+    EXPECT_EQ(few.counts, (std::vector<int>{1, 1, 0, 0, 0}));
+    EXPECT_EQ(few.offsets, (std::vector<int>{0, 1, 2, 2, 2}));
+
+    for (int rows = 0; rows <= 40; rows++) {
+        for (int ranks = 1; ranks <= 9; ranks++) {
+            RowPartition q = RowPartition::balanced(rows, ranks);
+            const auto [least, most] = std::minmax_element(q.counts.begin(), q.counts.end());
+            EXPECT_LE(*most - *least, 1) << rows << " rows on " << ranks << " ranks";
+            EXPECT_EQ(q.offsets[0], 0);
+            for (int r = 0; r + 1 < ranks; r++) {
+                EXPECT_EQ(q.offsets[r] + q.counts[r], q.offsets[r + 1]) << rows << " rows on " << ranks << " ranks";
+            }
+            EXPECT_EQ(q.offsets[ranks - 1] + q.counts[ranks - 1], rows) << rows << " rows on " << ranks << " ranks";
+        }
+    }
+}
+
+/*
+ * The nonzeros of a CSR matrix follow its row blocks, empty rows and blocks included
+ */
+TEST(DistributionTests, NonzeroPartitionTest) {
+    // Rows of 2, 0, 3, 1 and 0 nonzeros, in blocks of 2, 2 and 1 rows
+    const std::vector<int> rowPtr = {0, 2, 2, 5, 6, 6};
+    RowPartition nonzeros = nonzeroPartition(rowPtr, RowPartition::balanced(5, 3));
+    EXPECT_EQ(nonzeros.counts, (std::vector<int>{2, 4, 0}));
+    EXPECT_EQ(nonzeros.offsets, (std::vector<int>{0, 2, 6}));
+
+    nonzeros = nonzeroPartition(rowPtr, RowPartition::balanced(5, 7));
+    EXPECT_EQ(nonzeros.counts, (std::vector<int>{2, 0, 3, 1, 0, 0, 0}));
+    EXPECT_EQ(nonzeros.offsets, (std::vector<int>{0, 2, 2, 5, 6, 6, 6}));
+}
+
+/*
+ * Block-cyclic counts: whole blocks are dealt in turn and the partial last block goes to the
+ * process after the last whole one; every index lands on exactly one process
+ */
+TEST(DistributionTests, BlockCyclicCountTest) {
+    // Blocks [0, 3) and [6, 9) on process 0, [3, 6) and the partial [9, 10) on process 1
+    EXPECT_EQ(BlockCyclicLayout::localCount(10, 3, 0, 2), 6);
+    EXPECT_EQ(BlockCyclicLayout::localCount(10, 3, 1, 2), 4);
+    EXPECT_EQ(BlockCyclicLayout::localCount(5, 8, 1, 3), 0) << "Process past a single partial block";
+
+    for (int n = 0; n <= 50; n++) {
+        for (int nb = 1; nb <= 7; nb++) {
+            for (int nprocs = 1; nprocs <= 5; nprocs++) {
+                int total = 0;
+                for (int p = 0; p < nprocs; p++) {
+                    total += BlockCyclicLayout::localCount(n, nb, p, nprocs);
+                }
+                EXPECT_EQ(total, n) << n << " in blocks of " << nb << " over " << nprocs;
+            }
+        }
+    }
+}
+
+/*
+ * The subarray type of a row block selects the rows of the block, whole and in order; an
+ * empty block is the element type itself
+ */
+TEST(DistributionTests, RowBlockTypeTest) {
+    initMpi();
+    Matrix<int> m(7, 5);
+    for (int i = 0; i < m.rows(); i++) {
+        for (int j = 0; j < m.cols(); j++) {
+            m(i, j) = i * m.cols() + j;
+        }
+    }
+    const RowPartition partition = RowPartition::balanced(7, 3);
+    for (int rank = 0; rank < 3; rank++) {
+        MPI_Datatype type = rowBlockType(7, 5, partition, rank, MPI_INT);
+        std::vector<int> expected(partition.counts[rank] * 5);
+        std::iota(expected.begin(), expected.end(), partition.offsets[rank] * 5);
+        EXPECT_EQ(selectedElements(m, type), expected) << "Rows of block " << rank;
+        MPI_Type_free(&type);
+    }
+    EXPECT_EQ(rowBlockType(2, 5, RowPartition::balanced(2, 3), 2, MPI_INT), MPI_INT) << "Empty block";
+}
+
+/*
+ * The darray type of a grid rank selects the elements of its blocks in the row-major order
+ * of its local matrix, on a 2 x 3 grid with partial blocks on both sides
+ */
+TEST(DistributionTests, BlockCyclicTypeTest) {
+    initMpi();
+    const BlockCyclicLayout layout{7, 8, 2};
+    Matrix<int> m(7, 8);
+    for (int i = 0; i < m.rows(); i++) {
+        for (int j = 0; j < m.cols(); j++) {
+            m(i, j) = i * m.cols() + j;
+        }
+    }
+    ProcessGrid grid;
+    grid.rows = 2;
+    grid.cols = 3;
+    for (int gridRank = 0; gridRank < grid.rows * grid.cols; gridRank++) {
+        grid.myRow = gridRank / grid.cols;
+        grid.myCol = gridRank % grid.cols;
+        std::vector<int> expected;
+        for (int i = 0; i < m.rows(); i++) {
+            for (int j = 0; j < m.cols(); j++) {
+                if ((i / 2) % grid.rows == grid.myRow && (j / 2) % grid.cols == grid.myCol) {
+                    expected.push_back(m(i, j));
+                }
+            }
+        }
+        ASSERT_EQ(static_cast<int>(expected.size()), layout.localRows(grid) * layout.localCols(grid));
+        MPI_Datatype type = blockCyclicType(layout, grid, gridRank, MPI_INT);
+        EXPECT_EQ(selectedElements(m, type), expected) << "Elements of grid rank " << gridRank;
+        MPI_Type_free(&type);
+    }
+}
+
+/*
+ * Block-cyclic parts travel in rows: the scatter and the gather over the 1 x 1 grid of
+ * MPI_COMM_SELF give the matrix back, and the 50k x 50k part of a 100k x 100k matrix on a
+ * 2 x 2 grid, whose element count overflows an int, is an int count of rows
+ */
+TEST(DistributionTests, BlockCyclicRowCountTest) {
+    initMpi();
+    Matrix<int> m(7, 5);
+    for (int i = 0; i < m.rows(); i++) {
+        for (int j = 0; j < m.cols(); j++) {
+            m(i, j) = i * m.cols() + j;
+        }
+    }
+    const BlockCyclicLayout layout{7, 5, 2};
+    ProcessGrid grid = ProcessGrid::create(MPI_COMM_SELF);
+    Matrix<int> local = scatterBlockCyclic(m, layout, grid, 0);
+    EXPECT_EQ(local, m) << "Scatter over a single rank";
+    Matrix<int> gathered(7, 5);
+    gatherBlockCyclic(local, gathered, layout, grid, 0);
+    EXPECT_EQ(gathered, m) << "Gather over a single rank";
+    grid.free();
+
+    ProcessGrid square;
+    square.rows = 2;
+    square.cols = 2;
+    const BlockCyclicLayout huge{100000, 100000, 256};
+    const long long rows = huge.localRows(square);
+    const long long cols = huge.localCols(square);
+    EXPECT_GT(rows * cols, INT_MAX) << "The part would fit an element count";
+    RowType<std::int8_t> row(static_cast<int>(cols));
+    int rowBytes;
+    MPI_Type_size(row, &rowBytes);
+    EXPECT_LE(rows, INT_MAX);
+    EXPECT_EQ(rows * rowBytes, rows * cols) << "Rows of the row type do not cover the part";
+}
+
+// TEST ON PIPELINED PRODUCT ********************************************************
+// The following tests want to check that the pipelined product splits B into column panels
+// and A into row chunks, and puts every block back in its place in the local C and on root
+
+/*
+ * 150 rows (two row chunks) times 200 columns in panels of 64 (a last panel of 8), with and
+ * without the structure checks, against the plain product
+ */
+TEST(PipelineTests, PanelTest) {
+    initMpi();
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<> dis(-9, 9);
+    Matrix<int> A(150, 40), B(40, 200), expected(150, 200);
+    std::generate_n(A.data(), A.size(), [&] { return dis(gen); });
+    std::generate_n(B.data(), B.size(), [&] { return dis(gen); });
+    multiplyMatrices<int, int>(A, B, expected);
+
+    const RowPartition rows = RowPartition::balanced(A.rows(), 1);
+    for (bool structure : {false, true}) {
+        Matrix<int> localC(150, 200), C(150, 200);
+        multiplyPipelined<int, int>(A, B, localC, C, rows, 64, true, true, structure, 0, MPI_COMM_SELF);
+        EXPECT_EQ(localC, expected) << "Local C wrong, structure " << structure;
+        EXPECT_EQ(C, expected) << "Gathered C wrong, structure " << structure;
+    }
+}
+
+/*
+ * Structured factors cut into panels: the panels of an identity B are no identity of their
+ * own, and the second row chunk of an identity A is one only from its row offset (128)
+ */
+TEST(PipelineTests, StructuredPanelTest) {
+    initMpi();
+    Matrix<int> A(130, 48), identityB(48, 48), identityA(200, 200), B(200, 48);
+    for (int i = 0; i < A.rows(); i++) {
+        for (int j = 0; j < A.cols(); j++) {
+            A(i, j) = (i * 7 + j * 3) % 11 - 5;
+        }
+    }
+    for (int i = 0; i < 48; i++) {
+        identityB(i, i) = 1;
+    }
+    for (int i = 0; i < 200; i++) {
+        identityA(i, i) = 1;
+        for (int j = 0; j < 48; j++) {
+            B(i, j) = i - 2 * j;
+        }
+    }
+    Matrix<int> C;
+    Matrix<int> localC(130, 48);
+    multiplyPipelined<int, int>(A, identityB, localC, C, RowPartition::balanced(130, 1), 20, false, false, true, 0,
+                                MPI_COMM_SELF);
+    EXPECT_EQ(localC, A) << "A * I in panels";
+
+    Matrix<int> copyC(200, 48);
+    multiplyPipelined<int, int>(identityA, B, copyC, C, RowPartition::balanced(200, 1), 20, false, false, true, 0,
+                                MPI_COMM_SELF);
+    EXPECT_EQ(copyC, B) << "I * B in panels";
+}
+
+// TEST ON MATRIX FILES ********************************************************
+// The following tests want to check that matrices survive the text and binary file
+// formats unchanged, and that a damaged binary file is rejected
+
+/*
+ * The following test writes a random matrix in both formats and reads it back, and expects
+ * a print to a full device to fail
+ */
+TEST(MatrixFileTests, RoundTripTest) {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<> dis(-20000, 20000);
+
+    Matrix<int> original(13, 7);
+    for (int i = 0; i < original.rows(); i++) {
+        for (int j = 0; j < original.cols(); j++) {
+            original(i, j) = dis(gen);
+        }
+    }
+
+    const std::string textPath = ::testing::TempDir() + "roundtrip.txt";
+    const std::string binaryPath = ::testing::TempDir() + "roundtrip.bin";
+    writeMatrixText(textPath, original);
+    writeMatrixBinary(binaryPath, original);
+
+    EXPECT_FALSE(isBinaryMatrixFile(textPath));
+    EXPECT_TRUE(isBinaryMatrixFile(binaryPath));
+    EXPECT_EQ(readMatrix(textPath), original) << "Text round trip failed";
+    EXPECT_EQ(readMatrix(binaryPath, true), original) << "Binary round trip failed";
+
+    const int full = open("/dev/full", O_WRONLY);
+    if (full >= 0) {
+        EXPECT_THROW(printMatrix(full, original), std::runtime_error) << "Failed print went unnoticed";
+        close(full);
+    }
+}
+
+/*
+ * The following test parses text files with several threads, including a file that does not
+ * keep one row per line and must fall back to the serial parser
+ */
+TEST(MatrixFileTests, ParallelTextTest) {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<> dis(-20000, 20000);
+
+    Matrix<int> original(57, 31);
+    for (int i = 0; i < original.rows(); i++) {
+        for (int j = 0; j < original.cols(); j++) {
+            original(i, j) = dis(gen);
+        }
+    }
+
+    const std::string textPath = ::testing::TempDir() + "parallel.txt";
+    writeMatrixText(textPath, original);
+    for (int threads = 1; threads <= 8; threads++) {
+        EXPECT_EQ(readMatrixText(textPath, threads), original) << "Parallel parse failed with " << threads << " threads";
+    }
+
+    const std::string irregularPath = ::testing::TempDir() + "irregular.txt";
+    {
+        std::ofstream file(irregularPath);
+        file << "2 3\n1 +2\n\n3 -4 5   6\n";
+    }
+    Matrix<int> expected(2, 3);
+    expected(0, 0) = 1;
+    expected(0, 1) = 2;
+    expected(0, 2) = 3;
+    expected(1, 0) = -4;
+    expected(1, 1) = 5;
+    expected(1, 2) = 6;
+    EXPECT_EQ(readMatrixText(irregularPath, 4), expected) << "Irregular layout parse failed";
+
+    // Malformed values are rejected by the serial and the parallel parser alike
+    for (const char* value : {"+-5", "+", "1x", "--1"}) {
+        {
+            std::ofstream file(irregularPath);
+            file << "1 2\n1 " << value << "\n";
+        }
+        for (int threads : {1, 4}) {
+            EXPECT_THROW(readMatrixText(irregularPath, threads), std::runtime_error)
+                << "Malformed value " << value << " was accepted with " << threads << " threads";
+        }
+    }
+}
+
+/*
+ * The following test flips one payload byte of a binary file and expects the checksum to catch it,
+ * then cuts the payload short
+ */
+TEST(MatrixFileTests, ChecksumTest) {
+    Matrix<int> original(4, 4);
+    for (int i = 0; i < original.rows(); i++) {
+        original(i, i) = 1;
+    }
+
+    const std::string binaryPath = ::testing::TempDir() + "checksum.bin";
+    writeMatrixBinary(binaryPath, original);
+    {
+        std::fstream file(binaryPath, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(sizeof(MatrixFileHeader) + 5);
+        file.put(42);
+    }
+
+    EXPECT_THROW(mapMatrixBinary(binaryPath, true), std::runtime_error) << "Corrupted file was accepted";
+    EXPECT_THROW(verifyMatrixFile(binaryPath), std::runtime_error) << "Corrupted file was verified";
+
+    writeMatrixBinary(binaryPath, original);
+    EXPECT_NO_THROW(verifyMatrixFile(binaryPath)) << "Intact file was rejected";
+    ASSERT_EQ(truncate(binaryPath.c_str(), sizeof(MatrixFileHeader) + 8), 0);
+    EXPECT_THROW(verifyMatrixFile(binaryPath), std::runtime_error) << "Truncated file was verified";
+}
+
+/*
+ * The following test checks that binary files keep their element type, and that a file
+ * is not mapped as a different type
+ */
+TEST(MatrixFileTests, ElementTypeTest) {
+    const std::string path = ::testing::TempDir() + "test_matrix_int16.bin";
+    Matrix<std::int16_t> m(3, 5);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 5; j++) {
+            m(i, j) = static_cast<std::int16_t>(-30000 + 4000 * i + 7 * j);
+        }
+    }
+    writeMatrixBinary<std::int16_t>(path, m);
+
+    EXPECT_EQ(readMatrixHeader(path).dtype, DType::Int16) << "Element type not stored in the header";
+    EXPECT_EQ(mapMatrixBinary<std::int16_t>(path, true), m) << "int16 binary round trip failed";
+    EXPECT_THROW(mapMatrixBinary<int>(path), std::runtime_error) << "int16 file was mapped as int32";
+}
+
+/*
+ * The following test reads Matrix Market files with general, symmetric and pattern entries,
+ * and a dense text file straight into CSR
+ */
+TEST(MatrixFileTests, MatrixMarketTest) {
+    const std::string generalPath = ::testing::TempDir() + "general.mtx";
+    {
+        std::ofstream file(generalPath);
+        file << "%%MatrixMarket matrix coordinate integer general\n% a comment\n3 4 4\n"
+             << "3 4 -7\n1 1 2\n2 3 5\n1 1 1\n";
+    }
+    Matrix<int> general(3, 4);
+    general(0, 0) = 3;
+    general(1, 2) = 5;
+    general(2, 3) = -7;
+    EXPECT_TRUE(isMatrixMarketFile(generalPath));
+    EXPECT_EQ(toDense(readMatrixMarket(generalPath)), general) << "General Matrix Market read failed";
+
+    const std::string symmetricPath = ::testing::TempDir() + "symmetric.mtx";
+    {
+        std::ofstream file(symmetricPath);
+        file << "%%MatrixMarket matrix coordinate pattern symmetric\n3 3 3\n1 1\n3 1\n3 2\n";
+    }
+    Matrix<int> symmetric(3, 3);
+    symmetric(0, 0) = 1;
+    symmetric(2, 0) = symmetric(0, 2) = 1;
+    symmetric(2, 1) = symmetric(1, 2) = 1;
+    EXPECT_EQ(toDense(readMatrixMarket(symmetricPath)), symmetric) << "Symmetric pattern read failed";
+
+    const std::string textPath = ::testing::TempDir() + "sparse.txt";
+    writeMatrixText(textPath, general);
+    EXPECT_FALSE(isMatrixMarketFile(textPath));
+    EXPECT_EQ(toDense(readMatrixTextSparse(textPath)), general) << "Sparse text read failed";
+
+    const std::string badPath = ::testing::TempDir() + "bad.mtx";
+    {
+        std::ofstream file(badPath);
+        file << "%%MatrixMarket matrix coordinate integer general\n2 2 1\n3 1 4\n";
+    }
+    EXPECT_THROW(readMatrixMarket(badPath), std::runtime_error) << "Out-of-range entry was accepted";
+}
+
 // *********************************************************************************
 
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
-    return RUN_ALL_TESTS();
+    const int result = RUN_ALL_TESTS();
+    int initialized;
+    MPI_Initialized(&initialized);
+    if (initialized) {
+        MPI_Finalize();
+    }
+    return result;
 }